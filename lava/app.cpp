@@ -1,11 +1,16 @@
 #include "app.h"
 #include <SDL/SDL.h>
+#include <chrono>
 #include "renderer.h"
 
 using namespace lava;
 
+static const char * LAVA_FRAME_STATS_PATH = "frame_stats.json";
+static const char * LAVA_GPU_TRACE_PATH = "gpu_trace.json";
+static constexpr int LAVA_PAUSED_RENDER_SLEEP_MS = 16;
+
 App::App(const char * window_title, int width, int height)
-    : window_width(width), window_height(height)
+    : window_width(width), window_height(height), render_thread_stopping(false), render_paused(false)
 {
     SDL_Init(SDL_INIT_VIDEO);
 
@@ -19,27 +24,147 @@ void App::poll_events()
 {
     SDL_Event e;
     while (SDL_PollEvent(&e))
+        handle_event(e);
+}
+
+void App::wait_events(int timeout_ms)
+{
+    // Blocks the event thread instead of spinning while the render thread does the work
+    SDL_Event e;
+    if (SDL_WaitEventTimeout(&e, timeout_ms))
     {
-        switch (e.type)
-        {
-        case SDL_QUIT:
-            running = false;
-            break;
-        case SDL_WINDOWEVENT:
-            if (e.window.event == SDL_WINDOWEVENT_RESIZED)
-                renderer->handle_window_resize();
-            break;
-        }
+        handle_event(e);
+        poll_events();
+    }
+}
+
+void App::handle_event(const SDL_Event & e)
+{
+    switch (e.type)
+    {
+    case SDL_QUIT:
+        running = false;
+        break;
+    case SDL_WINDOWEVENT:
+        if (e.window.event == SDL_WINDOWEVENT_RESIZED)
+            send_render_event({ RenderEventType::window_resized, e.window.data1, e.window.data2 });
+        else if (e.window.event == SDL_WINDOWEVENT_MINIMIZED)
+            send_render_event({ RenderEventType::window_minimized, 0, 0 });
+        else if (e.window.event == SDL_WINDOWEVENT_RESTORED)
+            send_render_event({ RenderEventType::window_restored, 0, 0 });
+        break;
+    }
+}
+
+void App::send_render_event(const RenderEvent & event)
+{
+    if (!render_thread_running())
+    {
+        handle_render_event(event);
+        return;
+    }
+
+    // The render thread drains the queue once per frame, so a full queue only lasts until its next frame
+    while (!render_events.push(event) && !render_thread_stopping)
+        std::this_thread::yield();
+}
+
+void App::handle_render_event(const RenderEvent & event)
+{
+    switch (event.type)
+    {
+    case RenderEventType::window_resized:
+        window_width = event.width;
+        window_height = event.height;
+        renderer->handle_window_resize();
+        break;
+    case RenderEventType::window_minimized:
+        render_paused = true;
+        break;
+    case RenderEventType::window_restored:
+        render_paused = false;
+        break;
     }
 }
 
 void App::draw_frame()
 {
+    ScopedFrameTimer timer(renderer->stats(), FrameMetric::cpu);
     renderer->draw_frame();
 }
 
+void App::start_render_thread()
+{
+    if (render_thread_running())
+        return;
+
+    render_thread_stopping = false;
+    render_thread = std::thread([this]() { render_loop(); });
+}
+
+void App::stop_render_thread()
+{
+    if (!render_thread_running())
+        return;
+
+    render_thread_stopping = true;
+    render_thread.join();
+
+    // Events that arrived after the last frame still apply to the renderer
+    RenderEvent event;
+    while (render_events.pop(event))
+        handle_render_event(event);
+
+    if (render_thread_error)
+    {
+        std::exception_ptr error = render_thread_error;
+        render_thread_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void App::render_loop()
+{
+    try
+    {
+        while (!render_thread_stopping)
+        {
+            RenderEvent event;
+            while (render_events.pop(event))
+                handle_render_event(event);
+
+            // Nothing can be presented while minimized, so wait for the window to come back
+            if (render_paused)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(LAVA_PAUSED_RENDER_SLEEP_MS));
+                continue;
+            }
+            draw_frame();
+        }
+    }
+    catch (...)
+    {
+        // Reported by stop_render_thread() on the event thread. Stopping also releases an event
+        // thread spinning on a full queue, which nothing will drain anymore.
+        render_thread_error = std::current_exception();
+        render_thread_stopping = true;
+        running = false;
+    }
+}
+
 App::~App()
 {
+    // The renderer is only touched by the render thread until it has been joined
+    if (render_thread_running())
+    {
+        render_thread_stopping = true;
+        render_thread.join();
+    }
+
+    if (renderer->stats().frame_count() > 0)
+        renderer->stats().write_json(LAVA_FRAME_STATS_PATH);
+    if (renderer->gpu_profiler().enabled())
+        renderer->gpu_profiler().write_chrome_trace(LAVA_GPU_TRACE_PATH);
     renderer.reset();
     SDL_DestroyWindow(sdl_window);
     SDL_Quit();
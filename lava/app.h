@@ -2,12 +2,32 @@
 #define LAVA_APP_H
 
 #include <memory>
+#include <atomic>
+#include <thread>
+#include <exception>
+#include "spsc_queue.h"
 
 struct SDL_Window;
+union SDL_Event;
 
 namespace lava
 {
     class Renderer;
+
+    enum class RenderEventType
+    {
+        window_resized,
+        window_minimized,
+        window_restored
+    };
+
+    // Window state handed from the event thread to the render thread
+    struct RenderEvent
+    {
+        RenderEventType type;
+        int width, height;
+    };
+
     class App
     {
     public:
@@ -17,11 +37,28 @@ namespace lava
         const char * title;
         SDL_Window * sdl_window;
         std::unique_ptr<Renderer> renderer;
-        bool running;
+        std::atomic<bool> running;
         int window_width, window_height;
 
         void poll_events();
+        void wait_events(int timeout_ms);
         void draw_frame();
+
+        // Once started, the renderer belongs to the render thread and the calling thread should only pump events
+        void start_render_thread();
+        void stop_render_thread();
+        bool render_thread_running() const { return render_thread.joinable(); }
+    private:
+        void handle_event(const SDL_Event & e);
+        void send_render_event(const RenderEvent & event);
+        void handle_render_event(const RenderEvent & event);
+        void render_loop();
+
+        std::thread render_thread;
+        std::atomic<bool> render_thread_stopping;
+        std::exception_ptr render_thread_error;
+        SpscQueue<RenderEvent> render_events;
+        bool render_paused;
     };
 }
 
@@ -0,0 +1,140 @@
+#include "frame_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+using namespace lava;
+
+FrameStats::FrameStats(size_t window_size)
+    : window_size(window_size)
+{
+    for (auto & s : series)
+        s.window.reserve(window_size);
+}
+
+void FrameStats::record(FrameMetric metric, double milliseconds)
+{
+    Series & s = series[(size_t)metric];
+
+    // The histogram follows the window, so evicted samples leave their bucket
+    if (s.window.size() < window_size)
+        s.window.push_back(milliseconds);
+    else
+    {
+        s.histogram[bucket_index(s.window[s.next])]--;
+        s.window[s.next] = milliseconds;
+    }
+    s.next = (s.next + 1) % window_size;
+    s.histogram[bucket_index(milliseconds)]++;
+
+    s.total_samples++;
+    s.lifetime_max = std::max(s.lifetime_max, milliseconds);
+}
+
+MetricSummary FrameStats::summary(FrameMetric metric) const
+{
+    const Series & s = series[(size_t)metric];
+    MetricSummary result;
+    result.samples = s.window.size();
+    if (s.window.empty())
+        return result;
+
+    std::vector<double> sorted = s.window;
+    std::sort(sorted.begin(), sorted.end());
+
+    auto percentile = [&sorted](double p) -> double
+    {
+        size_t rank = (size_t)std::ceil(p * sorted.size());
+        return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+    };
+
+    result.p50 = percentile(0.50);
+    result.p95 = percentile(0.95);
+    result.p99 = percentile(0.99);
+    result.max = sorted.back();
+    double sum = 0.0;
+    for (double v : sorted)
+        sum += v;
+    result.mean = sum / sorted.size();
+    return result;
+}
+
+const std::array<uint32_t, FrameStats::HISTOGRAM_BUCKETS> & FrameStats::histogram(FrameMetric metric) const
+{
+    return series[(size_t)metric].histogram;
+}
+
+std::string FrameStats::to_json() const
+{
+    std::ostringstream out;
+    out << "{\n  \"window_size\": " << window_size << ",\n  \"frames\": " << frame_count() << ",\n  \"metrics\": {";
+    for (size_t i = 0; i < (size_t)FrameMetric::count; i++)
+    {
+        FrameMetric metric = (FrameMetric)i;
+        MetricSummary sum = summary(metric);
+        out << (i == 0 ? "\n" : ",\n");
+        out << "    \"" << metric_name(metric) << "\": {"
+            << "\"p50\": " << sum.p50 << ", \"p95\": " << sum.p95 << ", \"p99\": " << sum.p99
+            << ", \"max\": " << sum.max << ", \"mean\": " << sum.mean << ", \"samples\": " << sum.samples
+            << ", \"lifetime_max\": " << series[i].lifetime_max << ", \"histogram\": [";
+        for (size_t b = 0; b < HISTOGRAM_BUCKETS; b++)
+        {
+            if (b > 0) out << ", ";
+            out << "{\"le\": ";
+            if (b + 1 < HISTOGRAM_BUCKETS) out << bucket_upper_bound(b);
+            else out << "null";
+            out << ", \"count\": " << series[i].histogram[b] << "}";
+        }
+        out << "]}";
+    }
+    out << "\n  }\n}\n";
+    return out.str();
+}
+
+bool FrameStats::write_json(const std::string & path) const
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+        return false;
+    file << to_json();
+    return true;
+}
+
+const char * FrameStats::metric_name(FrameMetric metric)
+{
+    switch (metric)
+    {
+    case FrameMetric::cpu: return "cpu";
+    case FrameMetric::fence_wait: return "fence_wait";
+    case FrameMetric::acquire: return "acquire";
+    case FrameMetric::submit: return "submit";
+    case FrameMetric::present: return "present";
+    default: return "unknown";
+    }
+}
+
+double FrameStats::bucket_upper_bound(size_t bucket)
+{
+    return std::ldexp(1.0, (int)bucket - 4);
+}
+
+size_t FrameStats::bucket_index(double milliseconds)
+{
+    for (size_t b = 0; b + 1 < HISTOGRAM_BUCKETS; b++)
+        if (milliseconds <= bucket_upper_bound(b))
+            return b;
+    return HISTOGRAM_BUCKETS - 1;
+}
+
+ScopedFrameTimer::ScopedFrameTimer(FrameStats & stats, FrameMetric metric)
+    : stats(stats), metric(metric), start(std::chrono::steady_clock::now())
+{
+}
+
+ScopedFrameTimer::~ScopedFrameTimer()
+{
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    stats.record(metric, std::chrono::duration<double, std::milli>(elapsed).count());
+}
@@ -0,0 +1,79 @@
+#ifndef LAVA_FRAME_STATS_H
+#define LAVA_FRAME_STATS_H
+
+#include <array>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+namespace lava
+{
+    enum class FrameMetric
+    {
+        cpu,
+        fence_wait,
+        acquire,
+        submit,
+        present,
+        count
+    };
+
+    struct MetricSummary
+    {
+        double p50 = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+        double mean = 0.0;
+        size_t samples = 0;
+    };
+
+    // Rolling per-frame timings in milliseconds. Percentiles are taken over the last
+    // window_size frames; the histogram buckets are powers of two starting at 1/16 ms.
+    class FrameStats
+    {
+    public:
+        static constexpr size_t HISTOGRAM_BUCKETS = 16;
+
+        FrameStats(size_t window_size = 1024);
+
+        void record(FrameMetric metric, double milliseconds);
+        MetricSummary summary(FrameMetric metric) const;
+        const std::array<uint32_t, HISTOGRAM_BUCKETS> & histogram(FrameMetric metric) const;
+        uint64_t frame_count() const { return series[(size_t)FrameMetric::cpu].total_samples; }
+
+        std::string to_json() const;
+        bool write_json(const std::string & path) const;
+
+        static const char * metric_name(FrameMetric metric);
+        static double bucket_upper_bound(size_t bucket);
+    private:
+        struct Series
+        {
+            std::vector<double> window;
+            size_t next = 0;
+            uint64_t total_samples = 0;
+            double lifetime_max = 0.0;
+            std::array<uint32_t, HISTOGRAM_BUCKETS> histogram = {};
+        };
+
+        static size_t bucket_index(double milliseconds);
+
+        size_t window_size;
+        std::array<Series, (size_t)FrameMetric::count> series;
+    };
+
+    class ScopedFrameTimer
+    {
+    public:
+        ScopedFrameTimer(FrameStats & stats, FrameMetric metric);
+        ~ScopedFrameTimer();
+    private:
+        FrameStats & stats;
+        FrameMetric metric;
+        std::chrono::steady_clock::time_point start;
+    };
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include "lvk.h"
+#include "lvk/host_allocator.h"
 #include <vector>
 #include <functional>
 #include <algorithm>
@@ -159,7 +160,7 @@ VkShaderModule lvk::create_shader_module(VkDevice device, const std::vector<char
     create_info.pCode = (uint32_t *)(source.data());
 
     VkShaderModule module;
-    if (vkCreateShaderModule(device, &create_info, nullptr, &module) != VK_SUCCESS)
+    if (vkCreateShaderModule(device, &create_info, lvk::host_callbacks(), &module) != VK_SUCCESS)
         throw std::runtime_error("Error creating shader module");
 
     return module;
@@ -222,7 +223,7 @@ VkInstance lvk::create_instance(uint32_t api_version, std::vector<const char *>
     instance_info.pNext = pNext;
     
     VkInstance instance;
-    vkCreateInstance(&instance_info, nullptr, &instance);
+    vkCreateInstance(&instance_info, lvk::host_callbacks(), &instance);
     return instance;
 }
 
@@ -233,7 +234,7 @@ VkDebugUtilsMessengerEXT lvk::create_debug_messenger(VkInstance instance, VkDebu
     auto func = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
     if (func)
     {
-        if (func(instance, &info, nullptr, &debug_messenger) != VK_SUCCESS)
+        if (func(instance, &info, lvk::host_callbacks(), &debug_messenger) != VK_SUCCESS)
             throw std::runtime_error("Couldn't create default debug messenger!");
     }
     else throw std::runtime_error("Couldn't locate proc addr of \"vkCreateDebugUtilsMessengerEXT\"!");
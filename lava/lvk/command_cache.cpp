@@ -0,0 +1,84 @@
+#include "command_cache.h"
+#include "host_allocator.h"
+#include <stdexcept>
+
+namespace lvk
+{
+    command_cache::command_cache(VkDevice device, uint32_t queue_family_index, uint32_t slot_count)
+        : vk_device(device)
+    {
+        VkCommandPoolCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        info.queueFamilyIndex = queue_family_index;
+        info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+        if (vkCreateCommandPool(vk_device, &info, host_callbacks(), &pool) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create command cache pool");
+
+        resize(slot_count);
+    }
+    void command_cache::destroy()
+    {
+        if (pool != VK_NULL_HANDLE)
+            vkDestroyCommandPool(vk_device, pool, host_callbacks());
+        pool = VK_NULL_HANDLE;
+        entries.clear();
+    }
+    VkCommandBuffer command_cache::get(uint32_t slot, const command_cache_key & key, const VkCommandBufferInheritanceInfo & inheritance, const record_function & record)
+    {
+        entry & e = entries[slot];
+        if (e.valid && e.key == key)
+        {
+            hit_count++;
+            return e.command_buffer;
+        }
+
+        if (e.command_buffer == VK_NULL_HANDLE)
+        {
+            VkCommandBufferAllocateInfo info = {};
+            info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            info.commandPool = pool;
+            info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            info.commandBufferCount = 1;
+
+            if (vkAllocateCommandBuffers(vk_device, &info, &e.command_buffer) != VK_SUCCESS)
+                throw std::runtime_error("Failed to allocate cached command buffer");
+        }
+
+        // Begin implicitly resets the buffer, the pool allows that per buffer
+        VkCommandBufferBeginInfo begin_info = {};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = inheritance.renderPass != VK_NULL_HANDLE ? VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT : 0;
+        begin_info.pInheritanceInfo = &inheritance;
+
+        e.valid = false;
+        if (vkBeginCommandBuffer(e.command_buffer, &begin_info) != VK_SUCCESS)
+            throw std::runtime_error("Failed to begin cached command buffer");
+        record(e.command_buffer);
+        if (vkEndCommandBuffer(e.command_buffer) != VK_SUCCESS)
+            throw std::runtime_error("Failed to record cached command buffer");
+
+        e.key = key;
+        e.valid = true;
+        record_count++;
+        return e.command_buffer;
+    }
+    void command_cache::invalidate(uint32_t slot)
+    {
+        entries[slot].valid = false;
+    }
+    void command_cache::invalidate_all()
+    {
+        for (auto & e : entries)
+            e.valid = false;
+    }
+    void command_cache::resize(uint32_t slot_count)
+    {
+        // Buffers beyond the new size go back to the pool, the rest only need re-recording
+        for (size_t i = slot_count; i < entries.size(); i++)
+            if (entries[i].command_buffer != VK_NULL_HANDLE)
+                vkFreeCommandBuffers(vk_device, pool, 1, &entries[i].command_buffer);
+        entries.resize(slot_count);
+        invalidate_all();
+    }
+}
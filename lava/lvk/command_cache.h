@@ -0,0 +1,60 @@
+#ifndef LVK_COMMAND_CACHE_H
+#define LVK_COMMAND_CACHE_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <functional>
+
+namespace lvk
+{
+    // The handles and versions a cached command buffer was recorded against
+    class command_cache_key
+    {
+    public:
+        template <class T>
+        command_cache_key & input(T handle) { values.push_back((uint64_t)handle); return *this; }
+
+        bool operator==(const command_cache_key & other) const { return values == other.values; }
+        bool operator!=(const command_cache_key & other) const { return values != other.values; }
+    private:
+        std::vector<uint64_t> values;
+    };
+
+    // Secondary command buffers that are recorded once and replayed until one of their
+    // inputs changes. A slot must not be looked up while the GPU may still be executing a
+    // primary that references it, since a stale slot is reset and recorded again in place.
+    class command_cache
+    {
+    public:
+        using record_function = std::function<void(VkCommandBuffer command_buffer)>;
+
+        command_cache() = default;
+        command_cache(VkDevice device, uint32_t queue_family_index, uint32_t slot_count);
+        void destroy();
+
+        VkCommandBuffer get(uint32_t slot, const command_cache_key & key, const VkCommandBufferInheritanceInfo & inheritance, const record_function & record);
+
+        void invalidate(uint32_t slot);
+        void invalidate_all();
+        void resize(uint32_t slot_count);
+
+        uint32_t slot_count() const { return (uint32_t)entries.size(); }
+        uint64_t hits() const { return hit_count; }
+        uint64_t records() const { return record_count; }
+    private:
+        struct entry
+        {
+            VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+            command_cache_key key;
+            bool valid = false;
+        };
+
+        VkDevice vk_device = VK_NULL_HANDLE;
+        VkCommandPool pool = VK_NULL_HANDLE;
+        std::vector<entry> entries;
+        uint64_t hit_count = 0;
+        uint64_t record_count = 0;
+    };
+}
+
+#endif
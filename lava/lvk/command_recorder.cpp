@@ -0,0 +1,145 @@
+#include "command_recorder.h"
+#include "host_allocator.h"
+#include "job_system.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace lvk
+{
+    command_recorder::command_recorder()
+    {
+    }
+    command_recorder::command_recorder(VkDevice device, uint32_t queue_family_index, uint32_t frame_count, job_system & jobs, uint32_t worker_count, VkCommandPoolCreateFlags pool_flags)
+        : vk_device(device), family_index(queue_family_index), flags(pool_flags), jobs(&jobs)
+    {
+        if (worker_count == 0)
+            worker_count = std::min(jobs.worker_count(), 8u);
+        worker_threads_count = worker_count;
+
+        create_pools(frame_count);
+    }
+    command_recorder::command_recorder(command_recorder && other)
+    {
+        *this = std::move(other);
+    }
+    command_recorder & command_recorder::operator=(command_recorder && other)
+    {
+        vk_device = other.vk_device;
+        family_index = other.family_index;
+        flags = other.flags;
+        worker_threads_count = other.worker_threads_count;
+        min_items_per_worker = other.min_items_per_worker;
+        pools = std::move(other.pools);
+        jobs = other.jobs;
+        other.pools.clear();
+        return *this;
+    }
+    command_recorder::~command_recorder()
+    {
+    }
+    void command_recorder::destroy()
+    {
+        destroy_pools();
+    }
+    void command_recorder::resize(uint32_t frame_count)
+    {
+        destroy_pools();
+        create_pools(frame_count);
+    }
+    void command_recorder::reset(uint32_t frame)
+    {
+        for (uint32_t worker = 0; worker < worker_threads_count; worker++)
+        {
+            pool & p = worker_pool(frame, worker);
+            vkResetCommandPool(vk_device, p.vk_pool, 0);
+            p.used = 0;
+            p.primaries_used = 0;
+        }
+    }
+    std::vector<VkCommandBuffer> command_recorder::record(uint32_t frame, const VkCommandBufferInheritanceInfo & inheritance, uint32_t item_count, const record_function & record_range, VkCommandBufferUsageFlags usage)
+    {
+        if (item_count == 0)
+            return {};
+
+        uint32_t ranges = (item_count + min_items_per_worker - 1) / min_items_per_worker;
+        ranges = std::max(1u, std::min(ranges, (uint32_t)worker_threads_count));
+
+        std::vector<VkCommandBuffer> command_buffers(ranges, VK_NULL_HANDLE);
+
+        // One job per range, the range index picks the pool
+        jobs->parallel_for(ranges, 1, [&](uint32_t first_range, uint32_t last_range)
+        {
+            for (uint32_t worker = first_range; worker < last_range; worker++)
+            {
+                VkCommandBuffer command_buffer = acquire(worker_pool(frame, worker), VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+
+                VkCommandBufferBeginInfo begin_info = {};
+                begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                begin_info.flags = usage;
+                if (inheritance.renderPass != VK_NULL_HANDLE)
+                    begin_info.flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+                begin_info.pInheritanceInfo = &inheritance;
+
+                if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS)
+                    throw std::runtime_error("Failed to begin secondary command buffer");
+
+                uint32_t first = (uint32_t)((uint64_t)item_count * worker / ranges);
+                uint32_t last = (uint32_t)((uint64_t)item_count * (worker + 1) / ranges);
+                record_range(command_buffer, worker, first, last);
+
+                if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+                    throw std::runtime_error("Failed to record secondary command buffer");
+                command_buffers[worker] = command_buffer;
+            }
+        });
+        return command_buffers;
+    }
+    VkCommandBuffer command_recorder::acquire_primary(uint32_t frame)
+    {
+        return acquire(worker_pool(frame, 0), VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    }
+    void command_recorder::create_pools(uint32_t frame_count)
+    {
+        pools.resize(frame_count * worker_threads_count);
+        for (auto & p : pools)
+        {
+            VkCommandPoolCreateInfo info = {};
+            info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            info.queueFamilyIndex = family_index;
+            info.flags = flags;
+
+            if (vkCreateCommandPool(vk_device, &info, host_callbacks(), &p.vk_pool) != VK_SUCCESS)
+                throw std::runtime_error("Failed to create worker command pool");
+        }
+    }
+    void command_recorder::destroy_pools()
+    {
+        // Destroying a pool frees every command buffer allocated from it
+        for (auto & p : pools)
+            vkDestroyCommandPool(vk_device, p.vk_pool, host_callbacks());
+        pools.clear();
+    }
+    VkCommandBuffer command_recorder::acquire(pool & target, VkCommandBufferLevel level)
+    {
+        // Buffers survive a pool reset, so they are allocated once and then reused
+        bool primary = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        std::vector<VkCommandBuffer> & buffers = primary ? target.primaries : target.secondaries;
+        uint32_t & used = primary ? target.primaries_used : target.used;
+        if (used < buffers.size())
+            return buffers[used++];
+
+        VkCommandBufferAllocateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        info.commandPool = target.vk_pool;
+        info.level = level;
+        info.commandBufferCount = 1;
+
+        VkCommandBuffer command_buffer;
+        if (vkAllocateCommandBuffers(vk_device, &info, &command_buffer) != VK_SUCCESS)
+            throw std::runtime_error("Failed to allocate command buffer");
+        buffers.push_back(command_buffer);
+        used++;
+        return command_buffer;
+    }
+}
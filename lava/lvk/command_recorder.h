@@ -0,0 +1,68 @@
+#ifndef LVK_COMMAND_RECORDER_H
+#define LVK_COMMAND_RECORDER_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <functional>
+
+namespace lvk
+{
+    class job_system;
+
+    // Records secondary command buffers as jobs on a job_system. Each recording range owns
+    // one command pool per frame and runs as a single job, so no pool is ever touched by
+    // two threads and a frame's pools can be reset as a whole once the GPU is done with
+    // that frame. Create it with VK_COMMAND_POOL_CREATE_TRANSIENT_BIT when frames are
+    // re-recorded every time.
+    class command_recorder
+    {
+    public:
+        using record_function = std::function<void(VkCommandBuffer command_buffer, uint32_t worker, uint32_t first, uint32_t last)>;
+
+        command_recorder();
+        command_recorder(VkDevice device, uint32_t queue_family_index, uint32_t frame_count, job_system & jobs, uint32_t worker_count = 0, VkCommandPoolCreateFlags pool_flags = 0);
+        command_recorder(command_recorder && other);
+        command_recorder & operator=(command_recorder && other);
+        ~command_recorder();
+        void destroy();
+
+        void resize(uint32_t frame_count);
+        void reset(uint32_t frame);
+
+        // Splits [0, item_count) into contiguous ranges, one per worker, and returns the
+        // secondary command buffers in range order, ready for vkCmdExecuteCommands.
+        std::vector<VkCommandBuffer> record(uint32_t frame, const VkCommandBufferInheritanceInfo & inheritance, uint32_t item_count, const record_function & record_range, VkCommandBufferUsageFlags usage = 0);
+
+        // A primary command buffer from the calling thread's pool, valid until the frame is reset
+        VkCommandBuffer acquire_primary(uint32_t frame);
+
+        uint32_t worker_count() const { return (uint32_t)worker_threads_count; }
+        uint32_t frame_count() const { return pools.empty() ? 0 : (uint32_t)(pools.size() / worker_threads_count); }
+
+        void set_min_items_per_worker(uint32_t count) { min_items_per_worker = count; }
+    private:
+        struct pool
+        {
+            VkCommandPool vk_pool = VK_NULL_HANDLE;
+            std::vector<VkCommandBuffer> secondaries;
+            std::vector<VkCommandBuffer> primaries;
+            uint32_t used = 0;
+            uint32_t primaries_used = 0;
+        };
+
+        void create_pools(uint32_t frame_count);
+        void destroy_pools();
+        VkCommandBuffer acquire(pool & target, VkCommandBufferLevel level);
+        pool & worker_pool(uint32_t frame, uint32_t worker) { return pools[frame * worker_threads_count + worker]; }
+
+        VkDevice vk_device = VK_NULL_HANDLE;
+        uint32_t family_index = 0;
+        VkCommandPoolCreateFlags flags = 0;
+        size_t worker_threads_count = 1;
+        uint32_t min_items_per_worker = 64;
+        std::vector<pool> pools;
+        job_system * jobs = nullptr;
+    };
+}
+
+#endif
@@ -0,0 +1,333 @@
+#include "defragmenter.h"
+#include "host_allocator.h"
+#include "resource_tracker.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace lvk
+{
+    // How many update() calls to skip after finding nothing worth moving
+    static constexpr uint32_t IDLE_FRAMES = 60;
+
+    defragmenter::defragmenter(VkDevice device, memory_allocator & allocator, queue graphics_queue, timeline & graphics_timeline, VkDeviceSize bytes_per_step)
+        : vk_device(device), allocator(&allocator), graphics(graphics_queue), graphics_timeline(&graphics_timeline), step_bytes(bytes_per_step)
+    {
+        VkCommandPoolCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        info.queueFamilyIndex = graphics.family_index;
+        if (vkCreateCommandPool(vk_device, &info, host_callbacks(), &command_pool) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create defragmentation command pool");
+    }
+    void defragmenter::destroy()
+    {
+        // Expects the device to be idle; moves in flight are abandoned and the owners keep their resources
+        if (vk_device == VK_NULL_HANDLE)
+            return;
+        for (const auto & m : moves)
+            destroy_resource(m.buffer, m.image, m.memory);
+        moves.clear();
+        release_replaced();
+        garbage.flush();
+        resources.clear();
+        vkDestroyCommandPool(vk_device, command_pool, host_callbacks());
+        vk_device = VK_NULL_HANDLE;
+    }
+    uint32_t defragmenter::track_buffer(VkBuffer * buffer, allocation * memory, const VkBufferCreateInfo & info,
+                                        VkPipelineStageFlags stages, VkAccessFlags access, const move_callback & on_moved)
+    {
+        tracked_resource resource = {};
+        resource.is_image = false;
+        resource.buffer = buffer;
+        resource.memory = memory;
+        resource.buffer_info = info;
+        resource.buffer_info.pNext = nullptr;
+        resource.stages = stages;
+        resource.access = access;
+        resource.on_moved = on_moved;
+        resources[next_id] = resource;
+        return next_id++;
+    }
+    uint32_t defragmenter::track_image(VkImage * image, allocation * memory, const VkImageCreateInfo & info, VkImageAspectFlags aspect, VkImageLayout layout,
+                                       VkPipelineStageFlags stages, VkAccessFlags access, const move_callback & on_moved)
+    {
+        tracked_resource resource = {};
+        resource.is_image = true;
+        resource.image = image;
+        resource.memory = memory;
+        resource.image_info = info;
+        resource.image_info.pNext = nullptr;
+        resource.aspect = aspect;
+        resource.layout = layout;
+        resource.stages = stages;
+        resource.access = access;
+        resource.on_moved = on_moved;
+        resources[next_id] = resource;
+        return next_id++;
+    }
+    void defragmenter::forget(uint32_t id)
+    {
+        // A copy in flight finishes into a resource nobody owns, which finish_moves() throws away
+        resources.erase(id);
+    }
+    void defragmenter::update()
+    {
+        uint64_t completed = graphics_timeline->completed();
+        garbage.collect(completed);
+        if (release_pending && garbage.size() == 0 && replaced.empty())
+        {
+            move_stats.blocks_released += allocator->release_empty_blocks();
+            release_pending = false;
+        }
+
+        if (!moves.empty())
+        {
+            if (completed >= copies_value)
+                finish_moves();
+            return;
+        }
+        if (idle_frames > 0)
+        {
+            idle_frames--;
+            return;
+        }
+        start_moves();
+    }
+    void defragmenter::start_moves()
+    {
+        // The emptiest block that holds only tracked resources, in a pool with other blocks to move them to
+        std::vector<memory_block_info> blocks = allocator->blocks();
+        const memory_block_info * source = nullptr;
+        for (const auto & block : blocks)
+        {
+            if (block.allocations == 0 || block.used * 2 > block.size)
+                continue;
+            bool other_blocks = std::any_of(blocks.begin(), blocks.end(), [&](const memory_block_info & other)
+            {
+                return other.pool == block.pool && other.memory != block.memory;
+            });
+            uint32_t tracked = (uint32_t)std::count_if(resources.begin(), resources.end(), [&](const std::pair<const uint32_t, tracked_resource> & entry)
+            {
+                return entry.second.memory->memory == block.memory && !entry.second.memory->dedicated;
+            });
+            if (!other_blocks || tracked != block.allocations)
+                continue;
+            if (source == nullptr || block.used < source->used)
+                source = &block;
+        }
+        if (source == nullptr)
+        {
+            idle_frames = IDLE_FRAMES;
+            return;
+        }
+
+        VkDeviceSize planned_bytes = 0;
+        for (auto & entry : resources)
+        {
+            tracked_resource & resource = entry.second;
+            if (resource.memory->memory != source->memory || resource.memory->dedicated)
+                continue;
+            if (planned_bytes >= step_bytes)
+                break;
+
+            move m = { entry.first, VK_NULL_HANDLE, VK_NULL_HANDLE, allocation() };
+            VkMemoryRequirements requirements;
+            if (resource.is_image)
+            {
+                if (vkCreateImage(vk_device, &resource.image_info, host_callbacks(), &m.image) != VK_SUCCESS)
+                    throw std::runtime_error("Failed to create image for defragmentation");
+                vkGetImageMemoryRequirements(vk_device, m.image, &requirements);
+            }
+            else
+            {
+                if (vkCreateBuffer(vk_device, &resource.buffer_info, host_callbacks(), &m.buffer) != VK_SUCCESS)
+                    throw std::runtime_error("Failed to create buffer for defragmentation");
+                vkGetBufferMemoryRequirements(vk_device, m.buffer, &requirements);
+            }
+
+            m.memory = allocator->allocate_for_move(requirements, *resource.memory);
+            if (m.memory.memory == VK_NULL_HANDLE)
+            {
+                destroy_resource(m.buffer, m.image, m.memory);
+                continue;
+            }
+            VkResult bound = resource.is_image ? vkBindImageMemory(vk_device, m.image, m.memory.memory, m.memory.offset) :
+                                                 vkBindBufferMemory(vk_device, m.buffer, m.memory.memory, m.memory.offset);
+            if (bound != VK_SUCCESS)
+            {
+                destroy_resource(m.buffer, m.image, m.memory);
+                continue;
+            }
+            moves.push_back(m);
+            planned_bytes += m.memory.size;
+        }
+        if (moves.empty())
+        {
+            idle_frames = IDLE_FRAMES;
+            return;
+        }
+
+        VkCommandBufferAllocateInfo alloc_info = {};
+        alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        alloc_info.commandPool = command_pool;
+        alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        alloc_info.commandBufferCount = 1;
+
+        VkCommandBuffer command_buffer;
+        if (vkAllocateCommandBuffers(vk_device, &alloc_info, &command_buffer) != VK_SUCCESS)
+            throw std::runtime_error("Failed to allocate defragmentation command buffer");
+
+        VkCommandBufferBeginInfo begin_info = {};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(command_buffer, &begin_info);
+        record_copies(command_buffer);
+        if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+            throw std::runtime_error("Failed to record defragmentation copies");
+
+        copies_value = graphics_timeline->next();
+        if (timeline_submit().command_buffer(command_buffer).signal(*graphics_timeline, copies_value).submit(graphics.vk_queue) != VK_SUCCESS)
+            throw std::runtime_error("Failed to submit defragmentation copies");
+
+        VkDevice device = vk_device;
+        VkCommandPool pool = command_pool;
+        garbage.defer(copies_value, [device, pool, command_buffer]() { vkFreeCommandBuffers(device, pool, 1, &command_buffer); });
+    }
+    void defragmenter::record_copies(VkCommandBuffer command_buffer)
+    {
+        // Frames already submitted keep reading the old resources, so they go back to their usual state afterwards
+        resource_tracker tracker;
+        for (const auto & m : moves)
+        {
+            const tracked_resource & resource = resources.at(m.id);
+            resource_state state = { resource.stages, resource.access, resource.layout };
+            if (resource.is_image)
+            {
+                const VkImageCreateInfo & info = resource.image_info;
+                tracker.track_image(*resource.image, resource.aspect, info.mipLevels, info.arrayLayers, state);
+                tracker.track_image(m.image, resource.aspect, info.mipLevels, info.arrayLayers);
+                tracker.use_image(*resource.image, 0, info.mipLevels, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+                tracker.use_image(m.image, 0, info.mipLevels, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+            }
+            else
+            {
+                VkDeviceSize size = resource.buffer_info.size;
+                tracker.track_buffer(*resource.buffer, size, state);
+                tracker.track_buffer(m.buffer, size);
+                tracker.use_buffer(*resource.buffer, 0, size, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+                tracker.use_buffer(m.buffer, 0, size, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+            }
+        }
+        tracker.flush(command_buffer);
+
+        for (const auto & m : moves)
+        {
+            const tracked_resource & resource = resources.at(m.id);
+            if (resource.is_image)
+            {
+                const VkImageCreateInfo & info = resource.image_info;
+                std::vector<VkImageCopy> regions(info.mipLevels);
+                for (uint32_t mip = 0; mip < info.mipLevels; mip++)
+                {
+                    VkImageCopy & region = regions[mip];
+                    region = {};
+                    region.srcSubresource.aspectMask = resource.aspect;
+                    region.srcSubresource.mipLevel = mip;
+                    region.srcSubresource.baseArrayLayer = 0;
+                    region.srcSubresource.layerCount = info.arrayLayers;
+                    region.dstSubresource = region.srcSubresource;
+                    region.extent.width = std::max(1u, info.extent.width >> mip);
+                    region.extent.height = std::max(1u, info.extent.height >> mip);
+                    region.extent.depth = std::max(1u, info.extent.depth >> mip);
+                }
+                vkCmdCopyImage(command_buffer, *resource.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               (uint32_t)regions.size(), regions.data());
+            }
+            else
+            {
+                VkBufferCopy region = {};
+                region.size = resource.buffer_info.size;
+                vkCmdCopyBuffer(command_buffer, *resource.buffer, m.buffer, 1, &region);
+            }
+        }
+
+        for (const auto & m : moves)
+        {
+            const tracked_resource & resource = resources.at(m.id);
+            if (resource.is_image)
+            {
+                tracker.use_image(*resource.image, 0, resource.image_info.mipLevels, resource.stages, resource.access, resource.layout);
+                tracker.use_image(m.image, 0, resource.image_info.mipLevels, resource.stages, resource.access, resource.layout);
+            }
+            else
+            {
+                tracker.use_buffer(*resource.buffer, 0, resource.buffer_info.size, resource.stages, resource.access);
+                tracker.use_buffer(m.buffer, 0, resource.buffer_info.size, resource.stages, resource.access);
+            }
+        }
+        tracker.flush(command_buffer);
+    }
+    void defragmenter::finish_moves()
+    {
+        // Frames submitted up to now may still use the old resources
+        uint64_t retire_value = graphics_timeline->last_submitted();
+        VkDevice device = vk_device;
+        memory_allocator * memory = allocator;
+
+        for (const auto & m : moves)
+        {
+            auto found = resources.find(m.id);
+            if (found == resources.end())
+            {
+                destroy_resource(m.buffer, m.image, m.memory);
+                continue;
+            }
+
+            tracked_resource & resource = found->second;
+            VkBuffer old_buffer = resource.is_image ? VK_NULL_HANDLE : *resource.buffer;
+            VkImage old_image = resource.is_image ? *resource.image : VK_NULL_HANDLE;
+            allocation old_memory = *resource.memory;
+            auto destroy_old = [device, memory, old_buffer, old_image, old_memory]()
+            {
+                if (old_buffer != VK_NULL_HANDLE)
+                    vkDestroyBuffer(device, old_buffer, host_callbacks());
+                if (old_image != VK_NULL_HANDLE)
+                    vkDestroyImage(device, old_image, host_callbacks());
+                memory->free(old_memory);
+            };
+            if (hold_replaced)
+                replaced.push_back(destroy_old);
+            else
+                garbage.defer(retire_value, destroy_old);
+
+            if (resource.is_image)
+                *resource.image = m.image;
+            else
+                *resource.buffer = m.buffer;
+            *resource.memory = m.memory;
+            move_stats.moves++;
+            move_stats.bytes_moved += m.memory.size;
+            if (resource.on_moved)
+                resource.on_moved();
+        }
+        moves.clear();
+        release_pending = true;
+    }
+    void defragmenter::release_replaced()
+    {
+        // Frames submitted up to now may still use the held resources, later ones can't
+        uint64_t retire_value = graphics_timeline->last_submitted();
+        for (auto & destroy_old : replaced)
+            garbage.defer(retire_value, destroy_old);
+        replaced.clear();
+    }
+    void defragmenter::destroy_resource(VkBuffer buffer, VkImage image, const allocation & memory)
+    {
+        if (buffer != VK_NULL_HANDLE)
+            vkDestroyBuffer(vk_device, buffer, host_callbacks());
+        if (image != VK_NULL_HANDLE)
+            vkDestroyImage(vk_device, image, host_callbacks());
+        allocator->free(memory);
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef LVK_DEFRAGMENTER_H
+#define LVK_DEFRAGMENTER_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <map>
+#include <functional>
+
+#include "memory_allocator.h"
+#include "queue.h"
+#include "timeline.h"
+
+namespace lvk
+{
+    struct defragmenter_stats
+    {
+        uint32_t moves = 0;
+        VkDeviceSize bytes_moved = 0;
+        uint32_t blocks_released = 0;
+    };
+
+    // Incrementally empties sparsely used memory blocks. Owners register resources the GPU
+    // only reads after they were uploaded, together with how they are used. update(), called
+    // once per frame, picks the emptiest block that holds nothing but registered resources,
+    // creates copies of up to bytes_per_step of them in fuller blocks and copies them on the
+    // graphics queue. A frame or more later, once the copies have completed, the owner's
+    // handle and allocation are replaced and its callback rebinds whatever referenced the old
+    // resource (descriptor sets, recorded command buffers). The old resource is destroyed
+    // once every frame submitted before the swap has completed, and empty blocks are
+    // returned to the driver. Owners that switch over one frame at a time instead hold
+    // replaced resources and release them once nothing they record uses them anymore.
+    class defragmenter
+    {
+    public:
+        using move_callback = std::function<void()>;
+
+        defragmenter() = default;
+        defragmenter(VkDevice device, memory_allocator & allocator, queue graphics_queue, timeline & graphics_timeline,
+                     VkDeviceSize bytes_per_step = 16 * 1024 * 1024);
+        void destroy();
+
+        // The create info must describe the resource as created, with TRANSFER_SRC and TRANSFER_DST usage and exclusive sharing
+        uint32_t track_buffer(VkBuffer * buffer, allocation * memory, const VkBufferCreateInfo & info,
+                              VkPipelineStageFlags stages, VkAccessFlags access, const move_callback & on_moved);
+        uint32_t track_image(VkImage * image, allocation * memory, const VkImageCreateInfo & info, VkImageAspectFlags aspect, VkImageLayout layout,
+                             VkPipelineStageFlags stages, VkAccessFlags access, const move_callback & on_moved);
+        void forget(uint32_t id);
+
+        void update();
+
+        // While held, replaced resources outlive every frame submitted before release_replaced()
+        void set_hold_replaced(bool hold) { hold_replaced = hold; }
+        void release_replaced();
+
+        bool moving() const { return !moves.empty(); }
+        const defragmenter_stats & stats() const { return move_stats; }
+    private:
+        struct tracked_resource
+        {
+            bool is_image;
+            VkBuffer * buffer;
+            VkImage * image;
+            allocation * memory;
+            VkBufferCreateInfo buffer_info;
+            VkImageCreateInfo image_info;
+            VkImageAspectFlags aspect;
+            VkImageLayout layout;
+            VkPipelineStageFlags stages;
+            VkAccessFlags access;
+            move_callback on_moved;
+        };
+        struct move
+        {
+            uint32_t id;
+            VkBuffer buffer;
+            VkImage image;
+            allocation memory;
+        };
+
+        void start_moves();
+        void record_copies(VkCommandBuffer command_buffer);
+        void finish_moves();
+        void destroy_resource(VkBuffer buffer, VkImage image, const allocation & memory);
+
+        VkDevice vk_device = VK_NULL_HANDLE;
+        memory_allocator * allocator = nullptr;
+        queue graphics;
+        timeline * graphics_timeline = nullptr;
+        VkCommandPool command_pool = VK_NULL_HANDLE;
+        VkDeviceSize step_bytes = 0;
+
+        std::map<uint32_t, tracked_resource> resources;
+        uint32_t next_id = 1;
+        std::vector<move> moves;
+        uint64_t copies_value = 0;
+        uint32_t idle_frames = 0;
+        bool release_pending = false;
+        bool hold_replaced = false;
+        std::vector<std::function<void()>> replaced;
+        deferred_queue garbage;
+        defragmenter_stats move_stats;
+    };
+}
+
+#endif
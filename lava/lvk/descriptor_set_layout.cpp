@@ -1,4 +1,5 @@
 #include "descriptor_set_layout.h"
+#include "host_allocator.h"
 #include "device.h"
 
 namespace lvk
@@ -31,6 +32,10 @@ namespace lvk
     {
         return layout_binding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, binding, count, stage_flags);
     }
+    descriptor_set_layout_builder & descriptor_set_layout_builder::uniform_buffer_dynamic(uint32_t binding, uint32_t count, VkShaderStageFlags stage_flags)
+    {
+        return layout_binding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, binding, count, stage_flags);
+    }
     descriptor_set_layout_builder & descriptor_set_layout_builder::combined_image_sampler(uint32_t binding, uint32_t count, VkShaderStageFlags stage_flags)
     {
         return layout_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, binding, count, stage_flags);
@@ -45,7 +50,7 @@ namespace lvk
 
     descriptor_set_layout::descriptor_set_layout(VkDescriptorSetLayoutCreateInfo create_info, VkDevice device)
     {
-        VkResult result = vkCreateDescriptorSetLayout(device, &create_info, nullptr, &vk_object);
+        VkResult result = vkCreateDescriptorSetLayout(device, &create_info, host_callbacks(), &vk_object);
         if (result != VK_SUCCESS)
             throw std::runtime_error("Could not create descriptor set layout");
     }
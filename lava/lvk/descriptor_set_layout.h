@@ -22,6 +22,7 @@ namespace lvk
         descriptor_set_layout_builder();
 
         descriptor_set_layout_builder & uniform_buffer(uint32_t binding, uint32_t count, VkShaderStageFlags stage_flags);
+        descriptor_set_layout_builder & uniform_buffer_dynamic(uint32_t binding, uint32_t count, VkShaderStageFlags stage_flags);
         descriptor_set_layout_builder & combined_image_sampler(uint32_t binding, uint32_t count, VkShaderStageFlags stage_flags);
 
         descriptor_set_layout_builder & layout_binding(VkDescriptorType type, uint32_t binding, uint32_t count, VkShaderStageFlags stage_flags);
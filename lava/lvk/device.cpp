@@ -1,4 +1,5 @@
 #include "device.h"
+#include "host_allocator.h"
 #include "physical_device.h"
 
 namespace lvk
@@ -41,8 +42,50 @@ namespace lvk
         enabled_features = features;
         return *this;
     }
+    device_builder & device_builder::features12(VkPhysicalDeviceVulkan12Features features)
+    {
+        enabled_features12 = features;
+        enabled_features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        enabled_features12.pNext = nullptr;
+        using_features12 = true;
+        return *this;
+    }
+    device_builder & device_builder::async_compute_queue()
+    {
+        using_async_compute = true;
+        return *this;
+    }
     device device_builder::build()
     {
+        // Async compute prefers a family without graphics, then a spare queue in a family already in use,
+        // and falls back to sharing the first queue of a compute capable family
+        uint32_t compute_family = 0;
+        uint32_t compute_index = 0;
+        if (using_async_compute)
+        {
+            compute_family = phys_device.has_mutually_exclusive_queue_family(VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT) ?
+                phys_device.mutually_exclusive_queue_family_index(VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT) :
+                phys_device.compatible_queue_family_index(VK_QUEUE_COMPUTE_BIT);
+
+            auto & infos = queue_infos_and_priorities.first;
+            auto & priorities = queue_infos_and_priorities.second;
+            bool requested = false;
+            for (size_t i = 0; i < infos.size(); i++)
+            {
+                if (infos[i].queueFamilyIndex != compute_family)
+                    continue;
+                requested = true;
+                if (infos[i].queueCount < phys_device.get_queue_families()[compute_family].queueCount)
+                {
+                    compute_index = infos[i].queueCount++;
+                    priorities[i].push_back(1.0f);
+                    infos[i].pQueuePriorities = priorities[i].data();
+                }
+            }
+            if (!requested)
+                queues(compute_family, 1);
+        }
+
         VkDeviceCreateInfo info = {};
         info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
         info.queueCreateInfoCount = (uint32_t)queue_infos_and_priorities.first.size();
@@ -51,23 +94,44 @@ namespace lvk
         info.enabledExtensionCount = (uint32_t)enabled_extensions.size();
         info.ppEnabledExtensionNames = enabled_extensions.data();
         info.enabledLayerCount = 0;
+        if (using_features12)
+            info.pNext = &enabled_features12;
 
         VkDevice vk_device;
-        VkResult result = vkCreateDevice(phys_device.vk(), &info, nullptr, &vk_device);
+        VkResult result = vkCreateDevice(phys_device.vk(), &info, host_callbacks(), &vk_device);
         if (result != VK_SUCCESS)
             throw std::runtime_error("Failed to create logical device");
 
-        return device(vk_device);
+        std::vector<queue> created_queues;
+        for (const auto & queue_info : queue_infos_and_priorities.first)
+        {
+            for (uint32_t i = 0; i < queue_info.queueCount; i++)
+            {
+                queue created;
+                created.family_index = queue_info.queueFamilyIndex;
+                vkGetDeviceQueue(vk_device, queue_info.queueFamilyIndex, i, &created.vk_queue);
+                created_queues.push_back(created);
+            }
+        }
+
+        queue compute;
+        if (using_async_compute)
+        {
+            compute.family_index = compute_family;
+            vkGetDeviceQueue(vk_device, compute_family, compute_index, &compute.vk_queue);
+        }
+
+        return device(vk_device, created_queues, compute);
     }
 
-    device::device(VkDevice device, std::vector<queue> queues) 
-        : active_queues(queues)
+    device::device(VkDevice device, std::vector<queue> queues, queue async_compute) 
+        : active_queues(queues), compute_queue(async_compute)
     {
         vk_object = device;
     }
     void device::destroy()
     {
-        vkDestroyDevice(vk_object, nullptr);
+        vkDestroyDevice(vk_object, host_callbacks());
         vk_object = VK_NULL_HANDLE;
     }
 }
\ No newline at end of file
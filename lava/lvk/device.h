@@ -12,13 +12,15 @@ namespace lvk
     class device : public object<VkDevice>
     {
     public:
-        device(VkDevice device = VK_NULL_HANDLE, std::vector<queue> queues = {});
+        device(VkDevice device = VK_NULL_HANDLE, std::vector<queue> queues = {}, queue async_compute = {});
         void destroy();
         ~device() {}
 
         const std::vector<queue> & queues() { return active_queues; }
+        const queue & async_compute_queue() const { return compute_queue; }
     private:
         std::vector<queue> active_queues;
+        queue compute_queue;
     };
 
     class device_builder
@@ -31,6 +33,8 @@ namespace lvk
         device_builder & extension(const char * name);
         device_builder & extensions(std::vector<const char *> names);
         device_builder & features(VkPhysicalDeviceFeatures features);
+        device_builder & features12(VkPhysicalDeviceVulkan12Features features);
+        device_builder & async_compute_queue();
 
         device build();
     private:
@@ -38,6 +42,9 @@ namespace lvk
         std::pair<std::vector<VkDeviceQueueCreateInfo>, std::vector<std::vector<float>>> queue_infos_and_priorities;
         std::vector<const char *> enabled_extensions;
         VkPhysicalDeviceFeatures enabled_features;
+        VkPhysicalDeviceVulkan12Features enabled_features12 = {};
+        bool using_features12 = false;
+        bool using_async_compute = false;
     };
 }
 
@@ -0,0 +1,89 @@
+#include "frame_scheduler.h"
+#include "host_allocator.h"
+#include <stdexcept>
+
+namespace lvk
+{
+    frame_scheduler::frame_scheduler(VkDevice device, timeline & timeline, uint32_t frames_in_flight, uint32_t image_count)
+        : vk_device(device), frame_timeline(&timeline)
+    {
+        create_slots(frames_in_flight);
+        image_values.resize(image_count, 0);
+    }
+    void frame_scheduler::destroy()
+    {
+        wait_all();
+        destroy_slots();
+        image_values.clear();
+    }
+    frame_slot & frame_scheduler::begin_frame()
+    {
+        frame_slot & slot = slots[current];
+        frame_timeline->wait(slot.timeline_value);
+        return slot;
+    }
+    void frame_scheduler::wait_for_image(uint32_t image_index)
+    {
+        // A swapchain image may still be in use by an older slot if acquire returns images out of order
+        frame_timeline->wait(image_values[image_index]);
+    }
+    uint64_t frame_scheduler::signal_value(uint32_t image_index)
+    {
+        uint64_t value = frame_timeline->next();
+        slots[current].timeline_value = value;
+        image_values[image_index] = value;
+        return value;
+    }
+    void frame_scheduler::end_frame()
+    {
+        current = (current + 1) % (uint32_t)slots.size();
+        frame_count++;
+    }
+    void frame_scheduler::set_frames_in_flight(uint32_t count)
+    {
+        if (count == 0)
+            throw std::invalid_argument("Frames in flight must be at least 1");
+        if (count == slots.size())
+            return;
+
+        wait_all();
+        destroy_slots();
+        create_slots(count);
+    }
+    void frame_scheduler::set_image_count(uint32_t count)
+    {
+        image_values.assign(count, 0);
+    }
+    void frame_scheduler::wait_all()
+    {
+        uint64_t latest = 0;
+        for (const auto & slot : slots)
+            latest = slot.timeline_value > latest ? slot.timeline_value : latest;
+        frame_timeline->wait(latest);
+    }
+    void frame_scheduler::create_slots(uint32_t count)
+    {
+        VkSemaphoreCreateInfo semaphore_info = {};
+        semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        slots.resize(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            slots[i].index = i;
+            slots[i].timeline_value = 0;
+            if (vkCreateSemaphore(vk_device, &semaphore_info, host_callbacks(), &slots[i].image_available) != VK_SUCCESS ||
+                vkCreateSemaphore(vk_device, &semaphore_info, host_callbacks(), &slots[i].render_finished) != VK_SUCCESS)
+                throw std::runtime_error("Failed to create frame slot semaphores");
+        }
+        current = 0;
+    }
+    void frame_scheduler::destroy_slots()
+    {
+        for (auto & slot : slots)
+        {
+            vkDestroySemaphore(vk_device, slot.image_available, host_callbacks());
+            vkDestroySemaphore(vk_device, slot.render_finished, host_callbacks());
+        }
+        slots.clear();
+    }
+}
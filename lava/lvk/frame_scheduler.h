@@ -0,0 +1,53 @@
+#ifndef LVK_FRAME_SCHEDULER_H
+#define LVK_FRAME_SCHEDULER_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+
+#include "timeline.h"
+
+namespace lvk
+{
+    struct frame_slot
+    {
+        uint32_t index = 0;
+        VkSemaphore image_available = VK_NULL_HANDLE;
+        VkSemaphore render_finished = VK_NULL_HANDLE;
+        uint64_t timeline_value = 0;
+    };
+
+    // Lets the CPU run ahead of the GPU by up to frames_in_flight() frames. Each frame
+    // only waits for the timeline value last signalled by the slot it is about to reuse.
+    class frame_scheduler
+    {
+    public:
+        frame_scheduler() = default;
+        frame_scheduler(VkDevice device, timeline & timeline, uint32_t frames_in_flight, uint32_t image_count);
+        void destroy();
+
+        frame_slot & begin_frame();
+        void wait_for_image(uint32_t image_index);
+        uint64_t signal_value(uint32_t image_index);
+        void end_frame();
+
+        void set_frames_in_flight(uint32_t count);
+        void set_image_count(uint32_t count);
+        void wait_all();
+
+        uint32_t frames_in_flight() const { return (uint32_t)slots.size(); }
+        frame_slot & current_slot() { return slots[current]; }
+        uint64_t frame_number() const { return frame_count; }
+    private:
+        void create_slots(uint32_t count);
+        void destroy_slots();
+
+        VkDevice vk_device = VK_NULL_HANDLE;
+        timeline * frame_timeline = nullptr;
+        std::vector<frame_slot> slots;
+        std::vector<uint64_t> image_values;
+        uint32_t current = 0;
+        uint64_t frame_count = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,176 @@
+#include "gpu_profiler.h"
+#include "host_allocator.h"
+#include "physical_device.h"
+
+#include <fstream>
+#include <stdexcept>
+
+namespace lvk
+{
+    gpu_profiler::gpu_profiler(VkDevice device, const physical_device & physical_device, uint32_t queue_family_index, uint32_t frame_count, uint32_t max_scopes_per_frame)
+        : vk_device(device), scopes_per_frame(max_scopes_per_frame)
+    {
+        frames.resize(frame_count);
+
+        const auto & properties = physical_device.get_properties();
+        uint32_t valid_bits = physical_device.get_queue_families()[queue_family_index].timestampValidBits;
+        if (valid_bits == 0)
+            return; // Queue can't write timestamps, scopes become no-ops
+
+        timestamp_period = properties.limits.timestampPeriod;
+        timestamp_mask = valid_bits >= 64 ? ~0ull : ((1ull << valid_bits) - 1);
+        supported = true;
+        create_query_pool();
+    }
+    void gpu_profiler::create_query_pool()
+    {
+        VkQueryPoolCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        info.queryCount = (uint32_t)frames.size() * scopes_per_frame * 2;
+
+        if (vkCreateQueryPool(vk_device, &info, host_callbacks(), &vk_object) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create timestamp query pool");
+    }
+    void gpu_profiler::destroy()
+    {
+        if (vk_object != VK_NULL_HANDLE)
+            vkDestroyQueryPool(vk_device, vk_object, host_callbacks());
+        vk_object = VK_NULL_HANDLE;
+    }
+    void gpu_profiler::resize(uint32_t frame_count)
+    {
+        // Pending results are dropped, the collected trace is kept
+        destroy();
+        std::vector<frame_queries> resized(frame_count);
+        for (uint32_t i = 0; i < frame_count && i < frames.size(); i++)
+            resized[i].name = frames[i].name;
+        frames = resized;
+        if (supported)
+            create_query_pool();
+    }
+    void gpu_profiler::name_frame(uint32_t frame, const std::string & name)
+    {
+        frames[frame].name = name;
+    }
+    void gpu_profiler::begin_frame(VkCommandBuffer command_buffer, uint32_t frame)
+    {
+        frame_queries & queries = frames[frame];
+        queries.scopes.clear();
+        queries.latest.clear();
+        queries.submitted = false;
+        if (enabled())
+            vkCmdResetQueryPool(command_buffer, vk_object, query_index(frame, 0, false), scopes_per_frame * 2);
+    }
+    uint32_t gpu_profiler::begin_scope(VkCommandBuffer command_buffer, uint32_t frame, const char * name, VkPipelineStageFlagBits stage)
+    {
+        frame_queries & queries = frames[frame];
+        uint32_t scope_index;
+        {
+            std::lock_guard<std::mutex> lock(*scope_mutex);
+            if (queries.scopes.size() >= scopes_per_frame)
+                throw std::runtime_error("Exceeded GPU profiler scopes per frame");
+
+            scope_index = (uint32_t)queries.scopes.size();
+            queries.scopes.push_back({ name, false });
+        }
+        if (enabled())
+            vkCmdWriteTimestamp(command_buffer, stage, vk_object, query_index(frame, scope_index, false));
+        return scope_index;
+    }
+    void gpu_profiler::end_scope(VkCommandBuffer command_buffer, uint32_t frame, uint32_t scope, VkPipelineStageFlagBits stage)
+    {
+        {
+            std::lock_guard<std::mutex> lock(*scope_mutex);
+            frames[frame].scopes[scope].closed = true;
+        }
+        if (enabled())
+            vkCmdWriteTimestamp(command_buffer, stage, vk_object, query_index(frame, scope, true));
+    }
+    void gpu_profiler::mark_submitted(uint32_t frame)
+    {
+        frames[frame].submitted = true;
+    }
+    bool gpu_profiler::collect(uint32_t frame)
+    {
+        frame_queries & queries = frames[frame];
+        if (!enabled() || !queries.submitted || queries.scopes.empty())
+            return false;
+
+        // Pairs of (timestamp, availability) for every begin/end query, fetched without VK_QUERY_RESULT_WAIT_BIT
+        uint32_t query_count = (uint32_t)queries.scopes.size() * 2;
+        std::vector<uint64_t> results(query_count * 2);
+        VkResult result = vkGetQueryPoolResults(vk_device, vk_object, query_index(frame, 0, false), query_count,
+                                                results.size() * sizeof(uint64_t), results.data(), 2 * sizeof(uint64_t),
+                                                VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        if (result != VK_SUCCESS && result != VK_NOT_READY)
+            return false;
+
+        std::vector<gpu_scope_timing> timings;
+        for (uint32_t i = 0; i < queries.scopes.size(); i++)
+        {
+            const uint64_t * begin = &results[(i * 2) * 2];
+            const uint64_t * end = &results[(i * 2 + 1) * 2];
+            if (!queries.scopes[i].closed || begin[1] == 0 || end[1] == 0)
+                return false;
+
+            uint64_t begin_ticks = begin[0] & timestamp_mask;
+            uint64_t end_ticks = end[0] & timestamp_mask;
+            if (base_timestamp == 0)
+                base_timestamp = begin_ticks;
+
+            gpu_scope_timing timing;
+            timing.name = queries.scopes[i].name;
+            timing.frame = frame;
+            timing.begin_ns = (uint64_t)((begin_ticks - base_timestamp) * timestamp_period);
+            timing.end_ns = (uint64_t)((end_ticks - base_timestamp) * timestamp_period);
+            timings.push_back(timing);
+        }
+
+        for (auto & timing : timings)
+        {
+            for (const auto & other : timings)
+                if (&other != &timing && other.begin_ns <= timing.begin_ns && other.end_ns >= timing.end_ns &&
+                    (other.begin_ns != timing.begin_ns || other.end_ns != timing.end_ns))
+                    timing.depth++;
+        }
+
+        queries.latest = timings;
+        queries.submitted = false;
+        for (const auto & timing : timings)
+        {
+            if (trace.size() >= max_trace_events)
+                trace.pop_front();
+            trace.push_back(timing);
+        }
+        return true;
+    }
+    bool gpu_profiler::write_chrome_trace(const std::string & path) const
+    {
+        std::ofstream file(path);
+        if (!file.is_open())
+            return false;
+
+        // Chrome/Perfetto JSON trace, one track per profiler frame, timestamps in microseconds
+        file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+        bool first = true;
+        for (uint32_t i = 0; i < frames.size(); i++)
+        {
+            std::string name = frames[i].name.empty() ? "frame " + std::to_string(i) : frames[i].name;
+            file << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << i
+                 << ", \"args\": {\"name\": \"" << name << "\"}}";
+            first = false;
+        }
+        for (const auto & event : trace)
+        {
+            file << ",\n{\"name\": \"" << event.name << "\", \"cat\": \"gpu\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << event.frame
+                 << ", \"ts\": " << event.begin_ns / 1000.0 << ", \"dur\": " << (event.end_ns - event.begin_ns) / 1000.0 << "}";
+        }
+        file << "\n]}\n";
+        return true;
+    }
+    uint32_t gpu_profiler::query_index(uint32_t frame, uint32_t scope, bool end) const
+    {
+        return (frame * scopes_per_frame + scope) * 2 + (end ? 1 : 0);
+    }
+}
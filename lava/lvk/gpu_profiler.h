@@ -0,0 +1,84 @@
+#ifndef LVK_GPU_PROFILER_H
+#define LVK_GPU_PROFILER_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <deque>
+#include <string>
+#include <mutex>
+#include <memory>
+
+#include "object.h"
+
+namespace lvk
+{
+    class physical_device;
+
+    struct gpu_scope_timing
+    {
+        std::string name;
+        uint32_t frame = 0;
+        uint32_t depth = 0;
+        uint64_t begin_ns = 0;
+        uint64_t end_ns = 0;
+
+        double milliseconds() const { return (end_ns - begin_ns) / 1000000.0; }
+    };
+
+    // Named GPU scopes measured with timestamp queries. Every "frame" owns a range of the
+    // query pool and is usually one pre-recorded command buffer; it is reset at the start
+    // of that command buffer so it can be replayed. Results are fetched without waiting,
+    // once the caller knows the last submission of the frame has completed. Scopes may be
+    // opened from several recording threads; nesting is derived from the GPU timestamps.
+    class gpu_profiler : public object<VkQueryPool>
+    {
+    public:
+        gpu_profiler() = default;
+        gpu_profiler(VkDevice device, const physical_device & physical_device, uint32_t queue_family_index, uint32_t frame_count, uint32_t max_scopes_per_frame = 32);
+        void destroy();
+
+        bool enabled() const { return vk_object != VK_NULL_HANDLE; }
+        uint32_t frame_count() const { return (uint32_t)frames.size(); }
+        void resize(uint32_t frame_count);
+        void name_frame(uint32_t frame, const std::string & name);
+
+        void begin_frame(VkCommandBuffer command_buffer, uint32_t frame);
+        uint32_t begin_scope(VkCommandBuffer command_buffer, uint32_t frame, const char * name, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+        void end_scope(VkCommandBuffer command_buffer, uint32_t frame, uint32_t scope, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+
+        void mark_submitted(uint32_t frame);
+        bool collect(uint32_t frame);
+
+        const std::vector<gpu_scope_timing> & latest_timings(uint32_t frame) const { return frames[frame].latest; }
+        bool write_chrome_trace(const std::string & path) const;
+    private:
+        struct scope
+        {
+            std::string name;
+            bool closed;
+        };
+        struct frame_queries
+        {
+            std::string name;
+            std::vector<scope> scopes;
+            std::vector<gpu_scope_timing> latest;
+            bool submitted = false;
+        };
+
+        void create_query_pool();
+        uint32_t query_index(uint32_t frame, uint32_t scope, bool end) const;
+
+        VkDevice vk_device = VK_NULL_HANDLE;
+        uint32_t scopes_per_frame = 0;
+        double timestamp_period = 1.0;
+        uint64_t timestamp_mask = ~0ull;
+        uint64_t base_timestamp = 0;
+        bool supported = false;
+        std::vector<frame_queries> frames;
+        std::unique_ptr<std::mutex> scope_mutex = std::unique_ptr<std::mutex>(new std::mutex());
+        std::deque<gpu_scope_timing> trace;
+        size_t max_trace_events = 200000;
+    };
+}
+
+#endif
@@ -0,0 +1,297 @@
+#include "host_allocator.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+namespace lvk
+{
+    static constexpr size_t ARENA_SIZE = 64 * 1024;
+    static constexpr size_t SMALLEST_SIZE_CLASS = 32;
+    static constexpr size_t POOL_CHUNK_SIZE = 64 * 1024;
+    // What malloc guarantees, the header keeps every payload at least this aligned
+    static constexpr size_t MIN_ALIGNMENT = 16;
+
+    enum host_source : uint16_t
+    {
+        HOST_SOURCE_HEAP,
+        HOST_SOURCE_ARENA,
+        HOST_SOURCE_POOL
+    };
+
+    // Sits right before every pointer handed to the driver
+    struct alignas(16) host_header
+    {
+        void * origin;      // The heap pointer, the owning arena or the pool slot
+        size_t size;
+        uint16_t scope;
+        uint16_t source;
+        uint16_t size_class;
+    };
+
+    // Rewound by its own thread once everything in it has been freed, which for command
+    // scope allocations is by the end of every Vulkan call. Arenas are never destroyed:
+    // a free may reach one after its thread has exited, so each thread that ever made a
+    // command scope allocation keeps ARENA_SIZE for the rest of the process.
+    struct host_arena
+    {
+        char * memory = nullptr;
+        size_t offset = 0;
+        std::atomic<uint32_t> live{ 0 };
+    };
+    static thread_local host_arena * thread_arena = nullptr;
+
+    static host_header * header_of(void * payload)
+    {
+        return reinterpret_cast<host_header *>(payload) - 1;
+    }
+    static char * align_up(char * pointer, size_t alignment)
+    {
+        return reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(pointer) + alignment - 1) & ~(uintptr_t)(alignment - 1));
+    }
+    static void * place(char * payload, void * origin, size_t size, VkSystemAllocationScope scope, host_source source, uint32_t size_class)
+    {
+        host_header * header = header_of(payload);
+        header->origin = origin;
+        header->size = size;
+        header->scope = (uint16_t)scope;
+        header->source = source;
+        header->size_class = (uint16_t)size_class;
+        return payload;
+    }
+    template <class T>
+    static host_scope_stats snapshot(const T & counters)
+    {
+        host_scope_stats result;
+        result.allocations = counters.allocations.load();
+        result.live = counters.live.load();
+        result.bytes = counters.bytes.load();
+        result.high_water = counters.high_water.load();
+        return result;
+    }
+
+    host_scope_stats host_allocator_stats::total() const
+    {
+        // Peaks of different scopes rarely coincide, so the summed high water is an upper bound
+        host_scope_stats result;
+        for (const auto & scope : scopes)
+        {
+            result.allocations += scope.allocations;
+            result.live += scope.live;
+            result.bytes += scope.bytes;
+            result.high_water += scope.high_water;
+        }
+        return result;
+    }
+
+    host_allocator & host_allocator::global()
+    {
+        // Never destroyed, the driver may free into it from its own teardown
+        static host_allocator * allocator = new host_allocator();
+        return *allocator;
+    }
+    host_allocator::host_allocator()
+    {
+        vk_callbacks = {};
+        vk_callbacks.pUserData = this;
+        vk_callbacks.pfnAllocation = vk_allocate;
+        vk_callbacks.pfnReallocation = vk_reallocate;
+        vk_callbacks.pfnFree = vk_free;
+        vk_callbacks.pfnInternalAllocation = vk_internal_allocation;
+        vk_callbacks.pfnInternalFree = vk_internal_free;
+    }
+    host_allocator_stats host_allocator::stats() const
+    {
+        host_allocator_stats result;
+        for (uint32_t i = 0; i < HOST_SCOPE_COUNT; i++)
+        {
+            result.scopes[i] = snapshot(scopes[i]);
+            result.internal_scopes[i] = snapshot(internal[i]);
+            result.internal.allocations += result.internal_scopes[i].allocations;
+            result.internal.live += result.internal_scopes[i].live;
+            result.internal.bytes += result.internal_scopes[i].bytes;
+            result.internal.high_water += result.internal_scopes[i].high_water;
+        }
+        result.arena_allocations = arena_allocations.load();
+        result.pool_allocations = pool_allocations.load();
+        result.heap_allocations = heap_allocations.load();
+        result.pool_reserved = pool_reserved.load();
+        return result;
+    }
+    void host_allocator::reset_high_water()
+    {
+        for (auto & scope : scopes)
+            scope.high_water.store(scope.bytes.load());
+        for (auto & scope : internal)
+            scope.high_water.store(scope.bytes.load());
+    }
+    void * host_allocator::allocate(size_t size, size_t alignment, VkSystemAllocationScope scope)
+    {
+        alignment = std::max(alignment, MIN_ALIGNMENT);
+
+        void * result = nullptr;
+        if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND)
+        {
+            if (!thread_arena)
+                thread_arena = new host_arena();
+            host_arena & arena = *thread_arena;
+            if (arena.live.load() == 0)
+                arena.offset = 0;
+            if (!arena.memory)
+                arena.memory = static_cast<char *>(std::malloc(ARENA_SIZE));
+
+            char * payload = arena.memory ? align_up(arena.memory + arena.offset + sizeof(host_header), alignment) : nullptr;
+            if (payload && payload + size <= arena.memory + ARENA_SIZE)
+            {
+                arena.offset = payload + size - arena.memory;
+                arena.live++;
+                arena_allocations++;
+                result = place(payload, &arena, size, scope, HOST_SOURCE_ARENA, 0);
+            }
+        }
+        else if (alignment == MIN_ALIGNMENT && size <= SMALLEST_SIZE_CLASS << (SIZE_CLASS_COUNT - 1))
+        {
+            uint32_t size_class = 0;
+            while ((SMALLEST_SIZE_CLASS << size_class) < size)
+                size_class++;
+            result = allocate_from_pool(size_class, size, scope);
+        }
+
+        if (!result)
+        {
+            char * base = static_cast<char *>(std::malloc(size + sizeof(host_header) + alignment));
+            if (!base)
+                return nullptr;
+            heap_allocations++;
+            result = place(align_up(base + sizeof(host_header), alignment), base, size, scope, HOST_SOURCE_HEAP, 0);
+        }
+
+        record_allocation(scopes[scope], size);
+        return result;
+    }
+    void * host_allocator::allocate_from_pool(uint32_t size_class, size_t size, VkSystemAllocationScope scope)
+    {
+        auto & pool = size_classes[size_class];
+        size_t slot_size = sizeof(host_header) + (SMALLEST_SIZE_CLASS << size_class);
+
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        if (!pool.free_list)
+        {
+            // Chunks are never returned, so nothing needs to remember them
+            char * chunk = static_cast<char *>(std::malloc(POOL_CHUNK_SIZE));
+            if (!chunk)
+                return nullptr;
+            for (size_t offset = 0; offset + slot_size <= POOL_CHUNK_SIZE; offset += slot_size)
+            {
+                char * slot = chunk + offset;
+                *reinterpret_cast<char **>(slot) = pool.free_list;
+                pool.free_list = slot;
+            }
+            pool_reserved += POOL_CHUNK_SIZE;
+        }
+
+        char * slot = pool.free_list;
+        pool.free_list = *reinterpret_cast<char **>(slot);
+        pool_allocations++;
+        return place(slot + sizeof(host_header), slot, size, scope, HOST_SOURCE_POOL, size_class);
+    }
+    void * host_allocator::reallocate(void * original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+    {
+        if (!original)
+            return allocate(size, alignment, scope);
+        if (size == 0)
+        {
+            free(original);
+            return nullptr;
+        }
+
+        // On failure the original has to stay valid
+        void * result = allocate(size, alignment, scope);
+        if (result)
+        {
+            std::memcpy(result, original, std::min(size, header_of(original)->size));
+            free(original);
+        }
+        return result;
+    }
+    void host_allocator::free(void * memory)
+    {
+        if (!memory)
+            return;
+
+        host_header * header = header_of(memory);
+        record_free(scopes[header->scope], header->size);
+        switch (header->source)
+        {
+        case HOST_SOURCE_ARENA:
+            static_cast<host_arena *>(header->origin)->live--;
+            break;
+        case HOST_SOURCE_POOL:
+        {
+            // The slot starts at the header, so it is read before being linked back in
+            auto & pool = size_classes[header->size_class];
+            char * slot = static_cast<char *>(header->origin);
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            *reinterpret_cast<char **>(slot) = pool.free_list;
+            pool.free_list = slot;
+            break;
+        }
+        default:
+            std::free(header->origin);
+            break;
+        }
+    }
+    void host_allocator::record_allocation(scope_counters & counters, size_t size)
+    {
+        counters.allocations++;
+        counters.live++;
+        size_t bytes = counters.bytes.fetch_add(size) + size;
+        size_t peak = counters.high_water.load();
+        while (bytes > peak && !counters.high_water.compare_exchange_weak(peak, bytes))
+            ;
+    }
+    void host_allocator::record_free(scope_counters & counters, size_t size)
+    {
+        counters.live--;
+        counters.bytes -= size;
+    }
+    void * host_allocator::vk_allocate(void * user_data, size_t size, size_t alignment, VkSystemAllocationScope scope)
+    {
+        return static_cast<host_allocator *>(user_data)->allocate(size, alignment, scope);
+    }
+    void * host_allocator::vk_reallocate(void * user_data, void * original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+    {
+        return static_cast<host_allocator *>(user_data)->reallocate(original, size, alignment, scope);
+    }
+    void host_allocator::vk_free(void * user_data, void * memory)
+    {
+        static_cast<host_allocator *>(user_data)->free(memory);
+    }
+    void host_allocator::vk_internal_allocation(void * user_data, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope)
+    {
+        // Executable memory is the only internal type there is
+        (void)type;
+        host_allocator * allocator = static_cast<host_allocator *>(user_data);
+        allocator->record_allocation(allocator->internal[scope], size);
+    }
+    void host_allocator::vk_internal_free(void * user_data, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope)
+    {
+        (void)type;
+        host_allocator * allocator = static_cast<host_allocator *>(user_data);
+        allocator->record_free(allocator->internal[scope], size);
+    }
+
+    const char * host_scope_name(VkSystemAllocationScope scope)
+    {
+        switch (scope)
+        {
+        case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND: return "command";
+        case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT: return "object";
+        case VK_SYSTEM_ALLOCATION_SCOPE_CACHE: return "cache";
+        case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE: return "device";
+        case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE: return "instance";
+        default: return "unknown";
+        }
+    }
+}
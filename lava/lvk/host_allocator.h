@@ -0,0 +1,96 @@
+#ifndef LVK_HOST_ALLOCATOR_H
+#define LVK_HOST_ALLOCATOR_H
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <mutex>
+
+namespace lvk
+{
+    constexpr uint32_t HOST_SCOPE_COUNT = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+    struct host_scope_stats
+    {
+        uint64_t allocations = 0;   // Made since startup, reallocations included
+        uint64_t live = 0;
+        size_t bytes = 0;           // Live bytes as requested by the driver
+        size_t high_water = 0;
+    };
+
+    struct host_allocator_stats
+    {
+        host_scope_stats scopes[HOST_SCOPE_COUNT];
+        host_scope_stats internal;  // Memory the driver allocated itself and only reported, all scopes
+        host_scope_stats internal_scopes[HOST_SCOPE_COUNT];
+        uint64_t arena_allocations = 0;
+        uint64_t pool_allocations = 0;
+        uint64_t heap_allocations = 0;
+        size_t pool_reserved = 0;   // Held by the size class pools, which never shrink
+
+        const host_scope_stats & scope(VkSystemAllocationScope scope) const { return scopes[scope]; }
+        host_scope_stats total() const;
+    };
+
+    // VkAllocationCallbacks for every object lvk and the renderer create, so driver host
+    // memory can be attributed per allocation scope. Command scope allocations, which only
+    // live for the call that made them, are bumped out of a per thread arena. Small
+    // allocations of the longer scopes come from size class pools, anything else from the
+    // heap. There is one allocator for the process: objects must be destroyed with the
+    // callbacks they were created with, and the driver may still free into it at exit.
+    class host_allocator
+    {
+    public:
+        static host_allocator & global();
+
+        const VkAllocationCallbacks * callbacks() const { return &vk_callbacks; }
+        host_allocator_stats stats() const;
+        // Starts the high water marks again from the live byte counts
+        void reset_high_water();
+    private:
+        static constexpr uint32_t SIZE_CLASS_COUNT = 5;     // 32 to 512 bytes
+
+        struct scope_counters
+        {
+            std::atomic<uint64_t> allocations{ 0 };
+            std::atomic<uint64_t> live{ 0 };
+            std::atomic<size_t> bytes{ 0 };
+            std::atomic<size_t> high_water{ 0 };
+        };
+        struct size_class
+        {
+            std::mutex mutex;
+            char * free_list = nullptr;     // Free slots link through their first bytes
+        };
+
+        host_allocator();
+        host_allocator(const host_allocator &) = delete;
+        host_allocator & operator=(const host_allocator &) = delete;
+
+        void * allocate(size_t size, size_t alignment, VkSystemAllocationScope scope);
+        void * reallocate(void * original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+        void free(void * memory);
+        void * allocate_from_pool(uint32_t size_class, size_t size, VkSystemAllocationScope scope);
+        void record_allocation(scope_counters & counters, size_t size);
+        void record_free(scope_counters & counters, size_t size);
+
+        static VKAPI_ATTR void * VKAPI_CALL vk_allocate(void * user_data, size_t size, size_t alignment, VkSystemAllocationScope scope);
+        static VKAPI_ATTR void * VKAPI_CALL vk_reallocate(void * user_data, void * original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+        static VKAPI_ATTR void VKAPI_CALL vk_free(void * user_data, void * memory);
+        static VKAPI_ATTR void VKAPI_CALL vk_internal_allocation(void * user_data, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+        static VKAPI_ATTR void VKAPI_CALL vk_internal_free(void * user_data, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+
+        VkAllocationCallbacks vk_callbacks;
+        scope_counters scopes[HOST_SCOPE_COUNT];
+        scope_counters internal[HOST_SCOPE_COUNT];
+        std::atomic<uint64_t> arena_allocations{ 0 };
+        std::atomic<uint64_t> pool_allocations{ 0 };
+        std::atomic<uint64_t> heap_allocations{ 0 };
+        std::atomic<size_t> pool_reserved{ 0 };
+        size_class size_classes[SIZE_CLASS_COUNT];
+    };
+
+    inline const VkAllocationCallbacks * host_callbacks() { return host_allocator::global().callbacks(); }
+    const char * host_scope_name(VkSystemAllocationScope scope);
+}
+
+#endif
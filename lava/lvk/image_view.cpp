@@ -1,4 +1,5 @@
 #include "image_view.h"
+#include "host_allocator.h"
 #include "device.h"
 
 namespace lvk
@@ -49,13 +50,13 @@ namespace lvk
     image_view::image_view(VkImageViewCreateInfo create_info, VkDevice device)
         : vk_device(device), info(create_info)
     {
-        VkResult result = vkCreateImageView(vk_device, &info, nullptr, &vk_object);
+        VkResult result = vkCreateImageView(vk_device, &info, host_callbacks(), &vk_object);
         if (result != VK_SUCCESS)
             throw std::runtime_error("Failed to create image view");
     }
     void image_view::destroy()
     {
-        vkDestroyImageView(vk_device, vk_object, nullptr);
+        vkDestroyImageView(vk_device, vk_object, host_callbacks());
         vk_object = VK_NULL_HANDLE;
     }
 }
\ No newline at end of file
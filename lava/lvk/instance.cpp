@@ -1,4 +1,5 @@
 #include "instance.h"
+#include "host_allocator.h"
 #include <iostream>
 #include <algorithm>
 #include <SDL/SDL_video.h>
@@ -149,7 +150,7 @@ namespace lvk
         }
 
         VkInstance vk_instance;
-        VkResult result = vkCreateInstance(&create_info, nullptr, &vk_instance);
+        VkResult result = vkCreateInstance(&create_info, host_callbacks(), &vk_instance);
         if (result != VK_SUCCESS)
             throw std::runtime_error("Failed to create vulkan instance");
 
@@ -158,7 +159,7 @@ namespace lvk
         {
             // Create the actual debug messenger to be used during runtime
             auto createDebugUtilsMessengerEXT = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(vk_instance, "vkCreateDebugUtilsMessengerEXT");
-            result = createDebugUtilsMessengerEXT(vk_instance, &debug_info, nullptr, &vk_debug_messenger);
+            result = createDebugUtilsMessengerEXT(vk_instance, &debug_info, host_callbacks(), &vk_debug_messenger);
             if (result != VK_SUCCESS)
                 throw std::runtime_error("Failed to create debug messenger");
         }
@@ -175,10 +176,10 @@ namespace lvk
         if (vk_debug_messenger != VK_NULL_HANDLE)
         {
             auto destroyDebugUtilsMessengerEXT = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(vk_object, "vkDestroyDebugUtilsMessengerEXT");
-            destroyDebugUtilsMessengerEXT(vk_object, vk_debug_messenger, nullptr);
+            destroyDebugUtilsMessengerEXT(vk_object, vk_debug_messenger, host_callbacks());
         }
 
-        vkDestroyInstance(vk_object, nullptr);
+        vkDestroyInstance(vk_object, host_callbacks());
     }
     VkSurfaceKHR instance::create_sdl_window_surface(SDL_Window * sdl_window)
     {
@@ -0,0 +1,202 @@
+#include "job_system.h"
+
+#include <algorithm>
+
+namespace lvk
+{
+    // Several job systems may exist at once (the scaling benchmark builds its own), so a
+    // thread only uses its queue index for the system that owns it
+    static thread_local const job_system * current_system = nullptr;
+    static thread_local uint32_t current_index = 0;
+
+    job_system::job_system(uint32_t worker_count)
+    {
+        if (worker_count == 0)
+            worker_count = std::max(std::thread::hardware_concurrency(), 1u);
+
+        for (uint32_t i = 0; i < worker_count; i++)
+            queues.emplace_back(new worker_queue());
+        for (uint32_t i = 1; i < worker_count; i++)
+            threads.emplace_back([this, i]() { worker_main(i); });
+    }
+    job_system::~job_system()
+    {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto & thread : threads)
+            thread.join();
+    }
+    void job_system::run(job work, job_counter * counter)
+    {
+        if (counter)
+            counter->pending++;
+        push({ std::move(work), counter });
+    }
+    void job_system::run_after(job_counter & dependency, job work, job_counter * counter)
+    {
+        // Counted right away, so waiting on counter also covers the job that hasn't been queued yet
+        if (counter)
+            counter->pending++;
+        {
+            std::lock_guard<std::mutex> lock(dependency.mutex);
+            if (dependency.pending.load() != 0)
+            {
+                dependency.continuations.push_back([this, work, counter]() { push({ work, counter }); });
+                return;
+            }
+        }
+        push({ std::move(work), counter });
+    }
+    void job_system::wait(job_counter & counter)
+    {
+        while (!counter.done())
+        {
+            queued_job queued;
+            if (pop(queued))
+                execute(queued);
+            else
+                std::this_thread::yield();
+        }
+
+        // The last job releases the mutex after its decrement, so the counter may be destroyed once this returns
+        std::exception_ptr error;
+        {
+            std::lock_guard<std::mutex> lock(counter.mutex);
+            std::swap(error, counter.error);
+        }
+        if (error)
+            std::rethrow_exception(error);
+    }
+    void job_system::parallel_for(uint32_t count, uint32_t grain, const range_function & body)
+    {
+        if (count == 0)
+            return;
+        grain = std::max(grain, 1u);
+        uint32_t chunks = (count - 1) / grain + 1;
+        if (chunks == 1 || worker_count() == 1)
+        {
+            body(0, count);
+            return;
+        }
+
+        job_counter counter;
+        for (uint32_t chunk = 1; chunk < chunks; chunk++)
+        {
+            uint32_t first = chunk * grain;
+            uint32_t last = std::min(count, first + grain);
+            run([&body, first, last]() { body(first, last); }, &counter);
+        }
+
+        // The other chunks reference body, so they have to finish before an error can unwind
+        std::exception_ptr error;
+        try
+        {
+            body(0, grain);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        wait(counter);
+        if (error)
+            std::rethrow_exception(error);
+    }
+    void job_system::push(queued_job queued)
+    {
+        worker_queue & queue = *queues[current_queue()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.jobs.push_back(std::move(queued));
+        }
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            queued_count++;
+        }
+        wake.notify_one();
+    }
+    bool job_system::pop(queued_job & queued)
+    {
+        // Newest job from our own queue first, it is the most likely to be in cache
+        uint32_t own = current_queue();
+        {
+            worker_queue & queue = *queues[own];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.jobs.empty())
+            {
+                queued = std::move(queue.jobs.back());
+                queue.jobs.pop_back();
+                queued_count--;
+                return true;
+            }
+        }
+
+        // Then the oldest job of another worker, which tends to be the largest piece of work left
+        for (uint32_t i = 1; i < queues.size(); i++)
+        {
+            worker_queue & victim = *queues[(own + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.jobs.empty())
+            {
+                queued = std::move(victim.jobs.front());
+                victim.jobs.pop_front();
+                queued_count--;
+                return true;
+            }
+        }
+        return false;
+    }
+    void job_system::execute(queued_job & queued)
+    {
+        std::exception_ptr error;
+        try
+        {
+            queued.work();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        job_counter * counter = queued.counter;
+        if (!counter)
+            return;
+
+        std::vector<std::function<void()>> ready;
+        {
+            std::lock_guard<std::mutex> lock(counter->mutex);
+            if (error && !counter->error)
+                counter->error = error;
+            if (--counter->pending == 0)
+                ready.swap(counter->continuations);
+        }
+        for (auto & continuation : ready)
+            continuation();
+    }
+    void job_system::worker_main(uint32_t index)
+    {
+        current_system = this;
+        current_index = index;
+
+        for (;;)
+        {
+            queued_job queued;
+            if (pop(queued))
+            {
+                execute(queued);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            wake.wait(lock, [&]() { return stopping || queued_count.load() > 0; });
+            if (stopping && queued_count.load() <= 0)
+                return;
+        }
+    }
+    uint32_t job_system::current_queue() const
+    {
+        return current_system == this ? current_index : 0;
+    }
+}
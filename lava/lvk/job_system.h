@@ -0,0 +1,88 @@
+#ifndef LVK_JOB_SYSTEM_H
+#define LVK_JOB_SYSTEM_H
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <thread>
+
+namespace lvk
+{
+    // Counts the jobs started against it that have not finished yet. Waiting on a counter
+    // rethrows the first exception thrown by one of its jobs, and jobs queued with
+    // run_after() start once it drops to zero.
+    class job_counter
+    {
+    public:
+        job_counter() = default;
+        job_counter(const job_counter &) = delete;
+        job_counter & operator=(const job_counter &) = delete;
+
+        bool done() const { return pending.load() == 0; }
+    private:
+        friend class job_system;
+
+        std::atomic<uint32_t> pending{ 0 };
+        std::mutex mutex;
+        std::vector<std::function<void()>> continuations;
+        std::exception_ptr error;
+    };
+
+    // Work-stealing scheduler with one queue per worker. Workers push and pop jobs at the
+    // back of their own queue and steal from the front of the others when it runs dry.
+    // Threads that are not workers share queue 0, and wait() runs queued jobs instead of
+    // blocking, so the waiting thread counts as one of the worker_count workers.
+    class job_system
+    {
+    public:
+        using job = std::function<void()>;
+        using range_function = std::function<void(uint32_t first, uint32_t last)>;
+
+        // worker_count includes the calling thread, 0 uses every hardware thread
+        job_system(uint32_t worker_count = 0);
+        job_system(const job_system &) = delete;
+        job_system & operator=(const job_system &) = delete;
+        ~job_system();
+
+        // Jobs without a counter must not throw, there is nobody to report the error to
+        void run(job work, job_counter * counter = nullptr);
+        void run_after(job_counter & dependency, job work, job_counter * counter = nullptr);
+        void wait(job_counter & counter);
+
+        // Splits [0, count) into chunks of grain items and blocks until all of them ran
+        void parallel_for(uint32_t count, uint32_t grain, const range_function & body);
+
+        uint32_t worker_count() const { return (uint32_t)queues.size(); }
+    private:
+        struct queued_job
+        {
+            job work;
+            job_counter * counter = nullptr;
+        };
+        struct worker_queue
+        {
+            std::mutex mutex;
+            std::deque<queued_job> jobs;
+        };
+
+        void push(queued_job queued);
+        bool pop(queued_job & queued);
+        void execute(queued_job & queued);
+        void worker_main(uint32_t index);
+        uint32_t current_queue() const;
+
+        std::vector<std::unique_ptr<worker_queue>> queues;
+        std::vector<std::thread> threads;
+        std::mutex wake_mutex;
+        std::condition_variable wake;
+        std::atomic<int32_t> queued_count{ 0 };
+        bool stopping = false;
+    };
+}
+
+#endif
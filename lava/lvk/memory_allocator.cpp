@@ -0,0 +1,343 @@
+#include "memory_allocator.h"
+#include "host_allocator.h"
+#include "device.h"
+#include "physical_device.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace lvk
+{
+    static VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    memory_allocator::memory_allocator(const device & device, const physical_device & physical_device, VkDeviceSize block_size)
+        : vk_device(device.vk()), phys_device(&physical_device), preferred_block_size(block_size), mutex(new std::mutex())
+    {
+        pools.resize(physical_device.get_memory_properties().memoryTypeCount * 2);
+        heap_bytes.resize(physical_device.get_memory_properties().memoryHeapCount);
+    }
+    void memory_allocator::destroy()
+    {
+        // Only the blocks are released here, dedicated allocations belong to their resources
+        for (uint32_t i = 0; i < pools.size(); i++)
+        {
+            for (auto & b : pools[i].blocks)
+                free_memory(b.memory, b.size, i / 2);
+            pools[i].blocks.clear();
+        }
+    }
+    allocation memory_allocator::allocate_buffer(VkBuffer buffer, VkMemoryPropertyFlags properties, bool dedicated)
+    {
+        VkBufferMemoryRequirementsInfo2 info = {};
+        info.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+        info.buffer = buffer;
+
+        VkMemoryDedicatedRequirements dedicated_requirements = {};
+        dedicated_requirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+        VkMemoryRequirements2 requirements = {};
+        requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+        requirements.pNext = &dedicated_requirements;
+        vkGetBufferMemoryRequirements2(vk_device, &info, &requirements);
+
+        dedicated = dedicated || dedicated_requirements.prefersDedicatedAllocation || dedicated_requirements.requiresDedicatedAllocation;
+        allocation result = allocate(requirements.memoryRequirements, properties, false, dedicated, buffer, VK_NULL_HANDLE);
+
+        if (vkBindBufferMemory(vk_device, buffer, result.memory, result.offset) != VK_SUCCESS)
+        {
+            free(result);
+            throw std::runtime_error("Failed to bind buffer memory");
+        }
+        return result;
+    }
+    allocation memory_allocator::allocate_image(VkImage image, VkMemoryPropertyFlags properties, bool dedicated, VkImageTiling tiling)
+    {
+        VkImageMemoryRequirementsInfo2 info = {};
+        info.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+        info.image = image;
+
+        VkMemoryDedicatedRequirements dedicated_requirements = {};
+        dedicated_requirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+        VkMemoryRequirements2 requirements = {};
+        requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+        requirements.pNext = &dedicated_requirements;
+        vkGetImageMemoryRequirements2(vk_device, &info, &requirements);
+
+        dedicated = dedicated || dedicated_requirements.prefersDedicatedAllocation || dedicated_requirements.requiresDedicatedAllocation;
+        allocation result = allocate(requirements.memoryRequirements, properties, tiling == VK_IMAGE_TILING_OPTIMAL, dedicated, VK_NULL_HANDLE, image);
+
+        if (vkBindImageMemory(vk_device, image, result.memory, result.offset) != VK_SUCCESS)
+        {
+            free(result);
+            throw std::runtime_error("Failed to bind image memory");
+        }
+        return result;
+    }
+    void memory_allocator::free(const allocation & allocation)
+    {
+        if (allocation.memory == VK_NULL_HANDLE)
+            return;
+
+        std::lock_guard<std::mutex> lock(*mutex);
+        if (allocation.dedicated)
+        {
+            free_memory(allocation.memory, allocation.size, allocation.memory_type);
+            dedicated_count--;
+            dedicated_bytes -= allocation.size;
+            return;
+        }
+
+        std::vector<block> & blocks = pools[allocation.pool].blocks;
+        auto found = std::find_if(blocks.begin(), blocks.end(), [&](const block & b) { return b.memory == allocation.memory; });
+        if (found == blocks.end())
+            throw std::logic_error("Freed an allocation that does not belong to this allocator");
+
+        block & b = *found;
+        b.used -= allocation.size;
+        b.allocations--;
+
+        VkDeviceSize offset = allocation.offset;
+        VkDeviceSize size = allocation.size;
+        auto next = b.free_ranges.lower_bound(offset);
+        if (next != b.free_ranges.end() && next->first == offset + size)
+        {
+            size += next->second;
+            next = b.free_ranges.erase(next);
+        }
+        if (next != b.free_ranges.begin() && std::prev(next)->first + std::prev(next)->second == offset)
+            std::prev(next)->second += size;
+        else
+            b.free_ranges[offset] = size;
+
+        // One empty block per pool is kept around so a free/allocate pattern doesn't hit the driver every time
+        if (b.allocations == 0)
+        {
+            bool other_empty = std::any_of(blocks.begin(), blocks.end(), [&](const block & other) { return &other != &b && other.allocations == 0; });
+            if (other_empty)
+            {
+                free_memory(b.memory, b.size, allocation.memory_type);
+                blocks.erase(found);
+            }
+        }
+    }
+    memory_allocator_stats memory_allocator::stats() const
+    {
+        std::lock_guard<std::mutex> lock(*mutex);
+        memory_allocator_stats result;
+        for (const auto & p : pools)
+        {
+            for (const auto & b : p.blocks)
+            {
+                result.blocks++;
+                result.allocations += b.allocations;
+                result.block_bytes += b.size;
+                result.used_bytes += b.used;
+                result.free_ranges += (uint32_t)b.free_ranges.size();
+                for (const auto & range : b.free_ranges)
+                    result.largest_free_range = std::max(result.largest_free_range, range.second);
+            }
+        }
+        result.dedicated_allocations = dedicated_count;
+        result.dedicated_bytes = dedicated_bytes;
+        result.device_allocations = result.blocks + dedicated_count;
+        return result;
+    }
+    VkDeviceSize memory_allocator::block_size(uint32_t memory_type) const
+    {
+        // Small heaps (BAR memory, integrated GPUs with little carve-out) get proportionally smaller blocks
+        const VkPhysicalDeviceMemoryProperties & properties = phys_device->get_memory_properties();
+        VkDeviceSize heap_size = properties.memoryHeaps[properties.memoryTypes[memory_type].heapIndex].size;
+        return std::min(preferred_block_size, heap_size / 8);
+    }
+    VkDeviceSize memory_allocator::heap_usage(uint32_t heap) const
+    {
+        std::lock_guard<std::mutex> lock(*mutex);
+        return heap < heap_bytes.size() ? heap_bytes[heap] : 0;
+    }
+    void memory_allocator::add_external_usage(uint32_t memory_type, VkDeviceSize size)
+    {
+        std::lock_guard<std::mutex> lock(*mutex);
+        heap_bytes[phys_device->get_memory_properties().memoryTypes[memory_type].heapIndex] += size;
+    }
+    void memory_allocator::remove_external_usage(uint32_t memory_type, VkDeviceSize size)
+    {
+        std::lock_guard<std::mutex> lock(*mutex);
+        heap_bytes[phys_device->get_memory_properties().memoryTypes[memory_type].heapIndex] -= size;
+    }
+    allocation memory_allocator::allocate(const VkMemoryRequirements & requirements, VkMemoryPropertyFlags properties, bool optimal, bool dedicated,
+                                          VkBuffer dedicated_buffer, VkImage dedicated_image)
+    {
+        uint32_t memory_type = phys_device->find_memory_type(requirements.memoryTypeBits, properties);
+        VkDeviceSize new_block_size = block_size(memory_type);
+
+        std::lock_guard<std::mutex> lock(*mutex);
+        if (dedicated || requirements.size > new_block_size / 2)
+            return allocate_dedicated(requirements, memory_type, dedicated_buffer, dedicated_image);
+
+        VkDeviceSize alignment = allocation_alignment(requirements, memory_type);
+        uint32_t pool_index = memory_type * 2 + (optimal ? 1 : 0);
+        allocation result;
+        result.memory_type = memory_type;
+        result.pool = pool_index;
+
+        pool & p = pools[pool_index];
+        for (auto & b : p.blocks)
+            if (allocate_from_block(b, requirements, alignment, result))
+                return result;
+
+        block b;
+        b.size = new_block_size;
+        b.memory = allocate_memory(b.size, memory_type, nullptr, &b.mapped);
+        if (b.memory == VK_NULL_HANDLE)
+            return allocate_dedicated(requirements, memory_type, dedicated_buffer, dedicated_image);
+        b.free_ranges[0] = b.size;
+        p.blocks.push_back(b);
+        allocate_from_block(p.blocks.back(), requirements, alignment, result);
+        return result;
+    }
+    std::vector<memory_block_info> memory_allocator::blocks() const
+    {
+        std::lock_guard<std::mutex> lock(*mutex);
+        std::vector<memory_block_info> result;
+        for (uint32_t i = 0; i < pools.size(); i++)
+            for (const auto & b : pools[i].blocks)
+                result.push_back({ b.memory, i, b.size, b.used, b.allocations });
+        return result;
+    }
+    allocation memory_allocator::allocate_for_move(const VkMemoryRequirements & requirements, const allocation & current)
+    {
+        std::lock_guard<std::mutex> lock(*mutex);
+        allocation result;
+        if (current.dedicated || !(requirements.memoryTypeBits & (1u << current.memory_type)))
+            return result;
+
+        result.memory_type = current.memory_type;
+        result.pool = current.pool;
+        VkDeviceSize alignment = allocation_alignment(requirements, current.memory_type);
+
+        // Fullest blocks first, so moves pack the survivors together instead of spreading them out
+        std::vector<block *> targets;
+        for (auto & b : pools[current.pool].blocks)
+            if (b.memory != current.memory)
+                targets.push_back(&b);
+        std::sort(targets.begin(), targets.end(), [](const block * a, const block * b) { return a->used > b->used; });
+        for (block * b : targets)
+            if (allocate_from_block(*b, requirements, alignment, result))
+                return result;
+        return allocation();
+    }
+    uint32_t memory_allocator::release_empty_blocks()
+    {
+        std::lock_guard<std::mutex> lock(*mutex);
+        uint32_t released = 0;
+        for (uint32_t i = 0; i < pools.size(); i++)
+        {
+            std::vector<block> & blocks = pools[i].blocks;
+            for (size_t b = blocks.size(); b-- > 0;)
+            {
+                if (blocks[b].allocations != 0)
+                    continue;
+                free_memory(blocks[b].memory, blocks[b].size, i / 2);
+                blocks.erase(blocks.begin() + b);
+                released++;
+            }
+        }
+        return released;
+    }
+    allocation memory_allocator::allocate_dedicated(const VkMemoryRequirements & requirements, uint32_t memory_type, VkBuffer buffer, VkImage image)
+    {
+        VkMemoryDedicatedAllocateInfo dedicated_info = {};
+        dedicated_info.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+        dedicated_info.buffer = buffer;
+        dedicated_info.image = image;
+
+        allocation result;
+        result.size = requirements.size;
+        result.memory_type = memory_type;
+        result.dedicated = true;
+        char * mapped = nullptr;
+        result.memory = allocate_memory(requirements.size, memory_type, &dedicated_info, &mapped);
+        if (result.memory == VK_NULL_HANDLE)
+            throw std::runtime_error("Failed to allocate dedicated device memory");
+        result.mapped = mapped;
+
+        dedicated_count++;
+        dedicated_bytes += requirements.size;
+        return result;
+    }
+    bool memory_allocator::allocate_from_block(block & b, const VkMemoryRequirements & requirements, VkDeviceSize alignment, allocation & result)
+    {
+        // Best fit keeps large ranges whole for large resources
+        auto best = b.free_ranges.end();
+        for (auto range = b.free_ranges.begin(); range != b.free_ranges.end(); ++range)
+        {
+            VkDeviceSize aligned = align_up(range->first, alignment);
+            if (aligned + requirements.size <= range->first + range->second && (best == b.free_ranges.end() || range->second < best->second))
+                best = range;
+        }
+        if (best == b.free_ranges.end())
+            return false;
+
+        VkDeviceSize range_offset = best->first;
+        VkDeviceSize range_end = best->first + best->second;
+        VkDeviceSize offset = align_up(range_offset, alignment);
+        b.free_ranges.erase(best);
+        if (offset > range_offset)
+            b.free_ranges[range_offset] = offset - range_offset;
+        if (range_end > offset + requirements.size)
+            b.free_ranges[offset + requirements.size] = range_end - offset - requirements.size;
+
+        b.used += requirements.size;
+        b.allocations++;
+
+        result.memory = b.memory;
+        result.offset = offset;
+        result.size = requirements.size;
+        result.mapped = b.mapped != nullptr ? b.mapped + offset : nullptr;
+        result.dedicated = false;
+        return true;
+    }
+    VkDeviceSize memory_allocator::allocation_alignment(const VkMemoryRequirements & requirements, uint32_t memory_type) const
+    {
+        // Mapped ranges of non-coherent memory are flushed in whole atoms, so neighbours must not share one
+        VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+        VkMemoryPropertyFlags type_flags = phys_device->get_memory_properties().memoryTypes[memory_type].propertyFlags;
+        if ((type_flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(type_flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+            alignment = std::max(alignment, phys_device->get_properties().limits.nonCoherentAtomSize);
+        return alignment;
+    }
+    VkDeviceMemory memory_allocator::allocate_memory(VkDeviceSize size, uint32_t memory_type, const void * next, char ** mapped)
+    {
+        VkMemoryAllocateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        info.pNext = next;
+        info.allocationSize = size;
+        info.memoryTypeIndex = memory_type;
+
+        VkDeviceMemory memory;
+        if (vkAllocateMemory(vk_device, &info, host_callbacks(), &memory) != VK_SUCCESS)
+            return VK_NULL_HANDLE;
+
+        *mapped = nullptr;
+        if (phys_device->get_memory_properties().memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        {
+            void * data;
+            if (vkMapMemory(vk_device, memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS)
+            {
+                vkFreeMemory(vk_device, memory, host_callbacks());
+                return VK_NULL_HANDLE;
+            }
+            *mapped = (char *)data;
+        }
+        heap_bytes[phys_device->get_memory_properties().memoryTypes[memory_type].heapIndex] += size;
+        return memory;
+    }
+    void memory_allocator::free_memory(VkDeviceMemory memory, VkDeviceSize size, uint32_t memory_type)
+    {
+        vkFreeMemory(vk_device, memory, host_callbacks());
+        heap_bytes[phys_device->get_memory_properties().memoryTypes[memory_type].heapIndex] -= size;
+    }
+}
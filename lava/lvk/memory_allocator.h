@@ -0,0 +1,121 @@
+#ifndef LVK_MEMORY_ALLOCATOR_H
+#define LVK_MEMORY_ALLOCATOR_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace lvk
+{
+    class device;
+    class physical_device;
+
+    struct allocation
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        // Already offset to this allocation, null unless the memory is host visible
+        void * mapped = nullptr;
+        uint32_t memory_type = 0;
+        uint32_t pool = 0;
+        bool dedicated = false;
+    };
+
+    struct memory_allocator_stats
+    {
+        uint32_t device_allocations = 0;    // Live vkAllocateMemory objects, blocks and dedicated
+        uint32_t blocks = 0;
+        uint32_t dedicated_allocations = 0;
+        uint32_t allocations = 0;           // Live sub-allocations inside blocks
+        VkDeviceSize block_bytes = 0;
+        VkDeviceSize used_bytes = 0;
+        VkDeviceSize dedicated_bytes = 0;
+        uint32_t free_ranges = 0;
+        VkDeviceSize largest_free_range = 0;
+
+        // 0 when all free block memory is one range, towards 1 as it splits into small holes
+        float fragmentation() const
+        {
+            VkDeviceSize free_bytes = block_bytes - used_bytes;
+            return free_bytes == 0 ? 0.0f : 1.0f - (float)largest_free_range / (float)free_bytes;
+        }
+    };
+
+    struct memory_block_info
+    {
+        VkDeviceMemory memory;
+        uint32_t pool;
+        VkDeviceSize size;
+        VkDeviceSize used;
+        uint32_t allocations;
+    };
+
+    // Sub-allocates buffers and images from large device memory blocks, one set of blocks
+    // per memory type. Linear resources (buffers, linear images) and optimal images live in
+    // separate pools so bufferImageGranularity never has to be padded for between
+    // neighbours. Resources the driver prefers dedicated memory for, and anything larger
+    // than half a block, get their own allocation. Host visible blocks stay mapped.
+    class memory_allocator
+    {
+    public:
+        memory_allocator() = default;
+        memory_allocator(const device & device, const physical_device & physical_device, VkDeviceSize block_size = 64 * 1024 * 1024);
+        void destroy();
+
+        // Allocate and bind
+        allocation allocate_buffer(VkBuffer buffer, VkMemoryPropertyFlags properties, bool dedicated = false);
+        allocation allocate_image(VkImage image, VkMemoryPropertyFlags properties, bool dedicated = false, VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL);
+        void free(const allocation & allocation);
+
+        memory_allocator_stats stats() const;
+        VkDeviceSize block_size(uint32_t memory_type) const;
+        // Device memory currently allocated from the heap, blocks counted whole
+        VkDeviceSize heap_usage(uint32_t heap) const;
+        // Memory other code allocates itself, so heap_usage() still covers it
+        void add_external_usage(uint32_t memory_type, VkDeviceSize size);
+        void remove_external_usage(uint32_t memory_type, VkDeviceSize size);
+
+        // Defragmentation support. allocate_for_move() only places the resource in another
+        // existing block of the same pool and returns an empty allocation if nothing fits.
+        std::vector<memory_block_info> blocks() const;
+        allocation allocate_for_move(const VkMemoryRequirements & requirements, const allocation & current);
+        // Returns every empty block to the driver, including the one normally kept in reserve
+        uint32_t release_empty_blocks();
+    private:
+        struct block
+        {
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkDeviceSize size = 0;
+            VkDeviceSize used = 0;
+            uint32_t allocations = 0;
+            char * mapped = nullptr;
+            std::map<VkDeviceSize, VkDeviceSize> free_ranges;   // Offset to size, neighbours always merged
+        };
+        struct pool
+        {
+            std::vector<block> blocks;
+        };
+
+        allocation allocate(const VkMemoryRequirements & requirements, VkMemoryPropertyFlags properties, bool optimal, bool dedicated,
+                            VkBuffer dedicated_buffer, VkImage dedicated_image);
+        allocation allocate_dedicated(const VkMemoryRequirements & requirements, uint32_t memory_type, VkBuffer buffer, VkImage image);
+        bool allocate_from_block(block & block, const VkMemoryRequirements & requirements, VkDeviceSize alignment, allocation & result);
+        VkDeviceSize allocation_alignment(const VkMemoryRequirements & requirements, uint32_t memory_type) const;
+        VkDeviceMemory allocate_memory(VkDeviceSize size, uint32_t memory_type, const void * next, char ** mapped);
+        void free_memory(VkDeviceMemory memory, VkDeviceSize size, uint32_t memory_type);
+
+        VkDevice vk_device = VK_NULL_HANDLE;
+        const physical_device * phys_device = nullptr;
+        VkDeviceSize preferred_block_size = 0;
+        std::vector<pool> pools;                // Two per memory type, linear then optimal
+        uint32_t dedicated_count = 0;
+        VkDeviceSize dedicated_bytes = 0;
+        std::vector<VkDeviceSize> heap_bytes;
+        std::unique_ptr<std::mutex> mutex;
+    };
+}
+
+#endif
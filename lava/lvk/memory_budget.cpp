@@ -0,0 +1,108 @@
+#include "memory_budget.h"
+#include "memory_allocator.h"
+#include "physical_device.h"
+
+#include <algorithm>
+
+namespace lvk
+{
+    // Without driver numbers other processes are invisible, so a margin is left for them
+    static constexpr float FALLBACK_BUDGET_SHARE = 0.8f;
+
+    memory_budget::memory_budget(const physical_device & physical_device, const memory_allocator & allocator, bool extension_enabled)
+        : phys_device(&physical_device), allocator(&allocator), use_extension(extension_enabled)
+    {
+        const VkPhysicalDeviceMemoryProperties & properties = physical_device.get_memory_properties();
+        heap_budgets.resize(properties.memoryHeapCount);
+        limits.resize(properties.memoryHeapCount, 0);
+        for (uint32_t i = 0; i < properties.memoryHeapCount; i++)
+        {
+            heap_budgets[i].heap = i;
+            heap_budgets[i].flags = properties.memoryHeaps[i].flags;
+            heap_budgets[i].size = properties.memoryHeaps[i].size;
+        }
+        update();
+    }
+    void memory_budget::update()
+    {
+        if (use_extension)
+        {
+            VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties = {};
+            budget_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+            VkPhysicalDeviceMemoryProperties2 properties = {};
+            properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+            properties.pNext = &budget_properties;
+            vkGetPhysicalDeviceMemoryProperties2(phys_device->vk(), &properties);
+
+            for (auto & heap : heap_budgets)
+            {
+                heap.budget = budget_properties.heapBudget[heap.heap];
+                heap.usage = budget_properties.heapUsage[heap.heap];
+            }
+        }
+        else
+        {
+            for (auto & heap : heap_budgets)
+            {
+                heap.budget = (VkDeviceSize)(heap.size * FALLBACK_BUDGET_SHARE);
+                heap.usage = allocator->heap_usage(heap.heap);
+            }
+        }
+
+        for (auto & heap : heap_budgets)
+            if (limits[heap.heap] != 0)
+                heap.budget = std::min(heap.budget, limits[heap.heap]);
+
+        // Callbacks may subscribe or unsubscribe, so they run after the crossings have been collected
+        struct crossing
+        {
+            callback on_crossed;
+            uint32_t heap;
+            float threshold;
+            bool rising;
+        };
+        std::vector<crossing> crossed;
+        for (auto & s : subscriptions)
+        {
+            for (const auto & heap : heap_budgets)
+            {
+                bool above = heap.pressure() >= s.threshold;
+                if (above != s.above[heap.heap])
+                {
+                    s.above[heap.heap] = above;
+                    crossed.push_back({ s.on_crossed, heap.heap, s.threshold, above });
+                }
+            }
+        }
+        for (const auto & c : crossed)
+            c.on_crossed(heap_budgets[c.heap], c.threshold, c.rising);
+    }
+    void memory_budget::set_limit(uint32_t heap, VkDeviceSize bytes)
+    {
+        limits[heap] = bytes;
+    }
+    uint32_t memory_budget::subscribe(float threshold, const callback & on_crossed)
+    {
+        subscriptions.push_back({ next_id, threshold, on_crossed, std::vector<bool>(heap_budgets.size(), false) });
+        return next_id++;
+    }
+    void memory_budget::unsubscribe(uint32_t id)
+    {
+        subscriptions.erase(std::remove_if(subscriptions.begin(), subscriptions.end(), [id](const subscription & s) { return s.id == id; }),
+                            subscriptions.end());
+    }
+    const heap_budget & memory_budget::device_local() const
+    {
+        const heap_budget * result = &heap_budgets.front();
+        bool found_local = false;
+        for (const auto & heap : heap_budgets)
+        {
+            if (!(heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT))
+                continue;
+            if (!found_local || heap.pressure() > result->pressure())
+                result = &heap;
+            found_local = true;
+        }
+        return *result;
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef LVK_MEMORY_BUDGET_H
+#define LVK_MEMORY_BUDGET_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <functional>
+
+namespace lvk
+{
+    class physical_device;
+    class memory_allocator;
+
+    struct heap_budget
+    {
+        uint32_t heap = 0;
+        VkMemoryHeapFlags flags = 0;
+        VkDeviceSize size = 0;
+        VkDeviceSize budget = 0;        // What this process can use without hurting itself or others
+        VkDeviceSize usage = 0;         // What this process is using
+
+        float pressure() const { return budget == 0 ? 0.0f : (float)usage / (float)budget; }
+    };
+
+    // Per heap usage and budget. With VK_EXT_memory_budget both come from the driver and
+    // account for other processes; without it usage is what the allocator has allocated,
+    // render graph attachments included, and the budget is a fixed share of the heap. A
+    // limit caps the budget of a heap, to keep several instances on one host inside an
+    // agreed envelope. Subscribers are told whenever update() finds a heap's pressure
+    // (usage over budget) has crossed their threshold, in either direction.
+    class memory_budget
+    {
+    public:
+        // threshold is the pressure that was crossed, rising tells in which direction
+        using callback = std::function<void(const heap_budget & heap, float threshold, bool rising)>;
+
+        memory_budget() = default;
+        memory_budget(const physical_device & physical_device, const memory_allocator & allocator, bool extension_enabled);
+
+        void update();
+        // 0 removes the limit
+        void set_limit(uint32_t heap, VkDeviceSize bytes);
+        uint32_t subscribe(float threshold, const callback & on_crossed);
+        void unsubscribe(uint32_t id);
+
+        const std::vector<heap_budget> & heaps() const { return heap_budgets; }
+        // The most pressured device local heap, which is usually the one worth reacting to
+        const heap_budget & device_local() const;
+        bool driver_reported() const { return use_extension; }
+    private:
+        struct subscription
+        {
+            uint32_t id;
+            float threshold;
+            callback on_crossed;
+            std::vector<bool> above;
+        };
+
+        const physical_device * phys_device = nullptr;
+        const memory_allocator * allocator = nullptr;
+        bool use_extension = false;
+        std::vector<heap_budget> heap_budgets;
+        std::vector<VkDeviceSize> limits;
+        std::vector<subscription> subscriptions;
+        uint32_t next_id = 1;
+    };
+}
+
+#endif
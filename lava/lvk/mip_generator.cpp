@@ -0,0 +1,354 @@
+#include "mip_generator.h"
+#include "host_allocator.h"
+#include "physical_device.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace lvk
+{
+    // Must match the workgroup size and tile of shaders/mipgen.comp
+    static constexpr uint32_t MIP_TILE_OUTPUTS = 32;
+
+    // The format the shader's storage images are declared with, for the formats it can write
+    static VkFormat storage_format(VkFormat format)
+    {
+        switch (format)
+        {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            return VK_FORMAT_R8G8B8A8_UNORM;
+        default:
+            return VK_FORMAT_UNDEFINED;
+        }
+    }
+    static bool is_srgb(VkFormat format)
+    {
+        return format == VK_FORMAT_R8G8B8A8_SRGB;
+    }
+    // Levels after a dispatch's first are reduced from the workgroup's tile, which takes
+    // even sides: an odd side's last texel would need a texel of the next tile
+    static uint32_t dispatch_levels(const mip_chain & chain, uint32_t source)
+    {
+        uint32_t count = 1;
+        while (count < mip_generator::MAX_LEVELS_PER_DISPATCH && source + count + 1 < chain.mip_levels)
+        {
+            uint32_t width = std::max(chain.width >> (source + count), 1u);
+            uint32_t height = std::max(chain.height >> (source + count), 1u);
+            if ((width > 1 && width % 2 != 0) || (height > 1 && height % 2 != 0))
+                break;
+            count++;
+        }
+        return count;
+    }
+
+    mip_generator::mip_generator(VkDevice device, const physical_device & physical_device, const std::vector<char> & shader_code)
+        : vk_device(device), vk_physical_device(physical_device.vk())
+    {
+        VkDescriptorSetLayoutBinding bindings[2] = {};
+        bindings[0].binding = 0;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        bindings[0].descriptorCount = 1;
+        bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[1] = bindings[0];
+        bindings[1].binding = 1;
+        bindings[1].descriptorCount = MAX_LEVELS_PER_DISPATCH;
+
+        VkDescriptorSetLayoutCreateInfo set_info = {};
+        set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        set_info.bindingCount = 2;
+        set_info.pBindings = bindings;
+
+        if (vkCreateDescriptorSetLayout(vk_device, &set_info, host_callbacks(), &set_layout) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create mip generation descriptor set layout");
+
+        VkPushConstantRange push_constants = {};
+        push_constants.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        push_constants.offset = 0;
+        push_constants.size = sizeof(dispatch_parameters);
+
+        VkPipelineLayoutCreateInfo layout_info = {};
+        layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        layout_info.setLayoutCount = 1;
+        layout_info.pSetLayouts = &set_layout;
+        layout_info.pushConstantRangeCount = 1;
+        layout_info.pPushConstantRanges = &push_constants;
+
+        if (vkCreatePipelineLayout(vk_device, &layout_info, host_callbacks(), &pipeline_layout) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create mip generation pipeline layout");
+
+        VkShaderModuleCreateInfo module_info = {};
+        module_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        module_info.codeSize = shader_code.size();
+        module_info.pCode = (const uint32_t *)shader_code.data();
+
+        VkShaderModule shader;
+        if (vkCreateShaderModule(vk_device, &module_info, host_callbacks(), &shader) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create mip generation shader module");
+
+        VkComputePipelineCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        info.stage.module = shader;
+        info.stage.pName = "main";
+        info.layout = pipeline_layout;
+
+        VkResult result = vkCreateComputePipelines(vk_device, VK_NULL_HANDLE, 1, &info, host_callbacks(), &pipeline);
+        vkDestroyShaderModule(vk_device, shader, host_callbacks());
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("Failed to create mip generation pipeline");
+    }
+    void mip_generator::destroy()
+    {
+        // Expects the device to be idle, like the other lvk destroy() calls
+        retire(0);
+        garbage.flush();
+
+        vkDestroyPipeline(vk_device, pipeline, host_callbacks());
+        vkDestroyPipelineLayout(vk_device, pipeline_layout, host_callbacks());
+        vkDestroyDescriptorSetLayout(vk_device, set_layout, host_callbacks());
+        pipeline = VK_NULL_HANDLE;
+    }
+    VkImageCreateFlags mip_generator::compute_flags(VkFormat format)
+    {
+        // Storage usage is otherwise only valid for formats that support it themselves, which sRGB ones rarely do
+        return storage_format(format) != format ? VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT | VK_IMAGE_CREATE_EXTENDED_USAGE_BIT : 0;
+    }
+    bool mip_generator::supports(const mip_chain & chain, mip_generation_path path) const
+    {
+        if (path == mip_generation_path::compute)
+        {
+            VkFormat view_format = storage_format(chain.format);
+            if (view_format == VK_FORMAT_UNDEFINED || !(chain.usage & VK_IMAGE_USAGE_STORAGE_BIT))
+                return false;
+            if (view_format != chain.format && (chain.flags & compute_flags(chain.format)) != compute_flags(chain.format))
+                return false;
+
+            VkFormatProperties properties;
+            vkGetPhysicalDeviceFormatProperties(vk_physical_device, view_format, &properties);
+            return (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) != 0;
+        }
+
+        VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(vk_physical_device, chain.format, &properties);
+        return (properties.optimalTilingFeatures & required) == required;
+    }
+    mip_generation_path mip_generator::path(const mip_chain & chain) const
+    {
+        mip_generation_path other = preferred == mip_generation_path::compute ? mip_generation_path::blit : mip_generation_path::compute;
+        if (supports(chain, preferred))
+            return preferred;
+        if (supports(chain, other))
+            return other;
+        throw std::runtime_error("Image format supports neither storage nor linear blits, its mipmaps can't be generated");
+    }
+    void mip_generator::record(VkCommandBuffer command_buffer, const std::vector<mip_chain> & chains, const resource_state & initial)
+    {
+        resource_tracker tracker;
+        std::vector<mip_chain> compute_chains;
+        std::vector<mip_chain> blit_chains;
+        for (const auto & chain : chains)
+        {
+            tracker.track_image(chain.image, VK_IMAGE_ASPECT_COLOR_BIT, chain.mip_levels, 1, initial);
+            if (path(chain) == mip_generation_path::compute)
+                compute_chains.push_back(chain);
+            else
+                blit_chains.push_back(chain);
+        }
+
+        if (!compute_chains.empty())
+            record_compute(command_buffer, compute_chains, tracker);
+        if (!blit_chains.empty())
+            record_blits(command_buffer, blit_chains, tracker);
+
+        for (const auto & chain : chains)
+            tracker.use_image(chain.image, 0, chain.mip_levels, chain.dst_stage, chain.dst_access, chain.final_layout);
+        tracker.flush(command_buffer);
+    }
+    void mip_generator::retire(uint64_t value)
+    {
+        if (recorded_views.empty() && recorded_pools.empty())
+            return;
+
+        VkDevice device = vk_device;
+        std::vector<VkImageView> views;
+        std::vector<VkDescriptorPool> pools;
+        std::swap(views, recorded_views);
+        std::swap(pools, recorded_pools);
+        garbage.defer(value, [device, views, pools]()
+        {
+            for (VkImageView view : views)
+                vkDestroyImageView(device, view, host_callbacks());
+            for (VkDescriptorPool pool : pools)
+                vkDestroyDescriptorPool(device, pool, host_callbacks());
+        });
+    }
+    void mip_generator::record_compute(VkCommandBuffer command_buffer, const std::vector<mip_chain> & chains, resource_tracker & tracker)
+    {
+        // Each chain needs a set per dispatch, all from one pool that is released with the views
+        uint32_t set_count = 0;
+        for (const auto & chain : chains)
+            for (uint32_t source = 0; source + 1 < chain.mip_levels; source += dispatch_levels(chain, source))
+                set_count++;
+        if (set_count == 0)
+            return;
+
+        VkDescriptorPoolSize pool_size = {};
+        pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        pool_size.descriptorCount = set_count * (MAX_LEVELS_PER_DISPATCH + 1);
+
+        VkDescriptorPoolCreateInfo pool_info = {};
+        pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        pool_info.maxSets = set_count;
+        pool_info.poolSizeCount = 1;
+        pool_info.pPoolSizes = &pool_size;
+
+        VkDescriptorPool pool;
+        if (vkCreateDescriptorPool(vk_device, &pool_info, host_callbacks(), &pool) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create mip generation descriptor pool");
+        recorded_pools.push_back(pool);
+
+        std::vector<std::vector<VkImageView>> views(chains.size());
+        for (size_t i = 0; i < chains.size(); i++)
+            for (uint32_t level = 0; level < chains[i].mip_levels; level++)
+                views[i].push_back(create_level_view(chains[i], level));
+
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+
+        // Round by round across all chains, so each step costs one barrier command however many images there are.
+        // Chains split their dispatches at different levels, so each keeps its own next source level.
+        std::vector<uint32_t> sources(chains.size(), 0);
+        std::vector<uint32_t> level_counts(chains.size(), 0);
+        for (bool pending = true; pending; )
+        {
+            for (size_t i = 0; i < chains.size(); i++)
+            {
+                const mip_chain & chain = chains[i];
+                uint32_t source = sources[i];
+                if (source + 1 >= chain.mip_levels)
+                    continue;
+                uint32_t level_count = level_counts[i] = dispatch_levels(chain, source);
+                tracker.use_image(chain.image, source, 1, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL);
+                tracker.use_image(chain.image, source + 1, level_count, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL);
+            }
+            tracker.flush(command_buffer);
+
+            for (size_t i = 0; i < chains.size(); i++)
+            {
+                const mip_chain & chain = chains[i];
+                uint32_t source = sources[i];
+                if (source + 1 >= chain.mip_levels)
+                    continue;
+                uint32_t level_count = level_counts[i];
+
+                VkDescriptorSetAllocateInfo alloc_info = {};
+                alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+                alloc_info.descriptorPool = pool;
+                alloc_info.descriptorSetCount = 1;
+                alloc_info.pSetLayouts = &set_layout;
+
+                VkDescriptorSet set;
+                if (vkAllocateDescriptorSets(vk_device, &alloc_info, &set) != VK_SUCCESS)
+                    throw std::runtime_error("Failed to allocate mip generation descriptor set");
+
+                // Slots past the last level repeat it; the shader never writes them, but every slot must be valid
+                VkDescriptorImageInfo source_info = { VK_NULL_HANDLE, views[i][source], VK_IMAGE_LAYOUT_GENERAL };
+                VkDescriptorImageInfo level_infos[MAX_LEVELS_PER_DISPATCH];
+                for (uint32_t slot = 0; slot < MAX_LEVELS_PER_DISPATCH; slot++)
+                    level_infos[slot] = { VK_NULL_HANDLE, views[i][source + 1 + std::min(slot, level_count - 1)], VK_IMAGE_LAYOUT_GENERAL };
+
+                VkWriteDescriptorSet writes[2] = {};
+                writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                writes[0].dstSet = set;
+                writes[0].dstBinding = 0;
+                writes[0].descriptorCount = 1;
+                writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+                writes[0].pImageInfo = &source_info;
+                writes[1] = writes[0];
+                writes[1].dstBinding = 1;
+                writes[1].descriptorCount = MAX_LEVELS_PER_DISPATCH;
+                writes[1].pImageInfo = level_infos;
+                vkUpdateDescriptorSets(vk_device, 2, writes, 0, nullptr);
+
+                dispatch_parameters parameters = {};
+                parameters.source_width = std::max((int32_t)(chain.width >> source), 1);
+                parameters.source_height = std::max((int32_t)(chain.height >> source), 1);
+                parameters.level_count = level_count;
+                parameters.srgb = is_srgb(chain.format) ? 1 : 0;
+
+                // One workgroup per tile of the first written level
+                uint32_t groups_x = (std::max(chain.width >> (source + 1), 1u) + MIP_TILE_OUTPUTS - 1) / MIP_TILE_OUTPUTS;
+                uint32_t groups_y = (std::max(chain.height >> (source + 1), 1u) + MIP_TILE_OUTPUTS - 1) / MIP_TILE_OUTPUTS;
+
+                vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout, 0, 1, &set, 0, nullptr);
+                vkCmdPushConstants(command_buffer, pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(parameters), &parameters);
+                vkCmdDispatch(command_buffer, groups_x, groups_y, 1);
+            }
+
+            pending = false;
+            for (size_t i = 0; i < chains.size(); i++)
+            {
+                if (sources[i] + 1 < chains[i].mip_levels)
+                    sources[i] += level_counts[i];
+                pending = pending || sources[i] + 1 < chains[i].mip_levels;
+            }
+        }
+    }
+    void mip_generator::record_blits(VkCommandBuffer command_buffer, const std::vector<mip_chain> & chains, resource_tracker & tracker)
+    {
+        uint32_t max_levels = 0;
+        for (const auto & chain : chains)
+            max_levels = std::max(max_levels, chain.mip_levels);
+
+        // Level by level across all images, so each step costs one barrier command however many images there are
+        for (uint32_t level = 1; level < max_levels; level++)
+        {
+            for (const auto & chain : chains)
+            {
+                if (level >= chain.mip_levels)
+                    continue;
+                tracker.use_image(chain.image, level - 1, 1, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+                tracker.use_image(chain.image, level, 1, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+            }
+            tracker.flush(command_buffer);
+
+            for (const auto & chain : chains)
+            {
+                if (level >= chain.mip_levels)
+                    continue;
+                VkImageBlit blit = {};
+                blit.srcOffsets[1] = { std::max((int32_t)(chain.width >> (level - 1)), 1), std::max((int32_t)(chain.height >> (level - 1)), 1), 1 };
+                blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                blit.srcSubresource.mipLevel = level - 1;
+                blit.srcSubresource.layerCount = 1;
+                blit.dstOffsets[1] = { std::max((int32_t)(chain.width >> level), 1), std::max((int32_t)(chain.height >> level), 1), 1 };
+                blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                blit.dstSubresource.mipLevel = level;
+                blit.dstSubresource.layerCount = 1;
+                vkCmdBlitImage(command_buffer, chain.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, chain.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               1, &blit, VK_FILTER_LINEAR);
+            }
+        }
+    }
+    VkImageView mip_generator::create_level_view(const mip_chain & chain, uint32_t level)
+    {
+        VkImageViewCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        info.image = chain.image;
+        info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        info.format = storage_format(chain.format);
+        info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        info.subresourceRange.baseMipLevel = level;
+        info.subresourceRange.levelCount = 1;
+        info.subresourceRange.baseArrayLayer = 0;
+        info.subresourceRange.layerCount = 1;
+
+        VkImageView view;
+        if (vkCreateImageView(vk_device, &info, host_callbacks(), &view) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create mip level view");
+        recorded_views.push_back(view);
+        return view;
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef LVK_MIP_GENERATOR_H
+#define LVK_MIP_GENERATOR_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+
+#include "timeline.h"
+#include "resource_tracker.h"
+
+namespace lvk
+{
+    class physical_device;
+
+    enum class mip_generation_path
+    {
+        compute,    // Up to MAX_LEVELS_PER_DISPATCH levels per dispatch through storage views
+        blit        // One linear blit and one barrier per level
+    };
+
+    // An image whose levels are filled from level 0, and the use its levels are left ready for
+    struct mip_chain
+    {
+        VkImage image;
+        VkFormat format;
+        VkImageUsageFlags usage;
+        VkImageCreateFlags flags;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mip_levels;
+        VkImageLayout final_layout;
+        VkPipelineStageFlags dst_stage;
+        VkAccessFlags dst_access;
+    };
+
+    // Generates mip chains on the GPU. The compute path reduces 64x64 tiles of a source
+    // level in shared memory and writes the next MAX_LEVELS_PER_DISPATCH levels in one
+    // dispatch, so a 4096 texture needs two dispatches and two barriers rather than twelve
+    // of each. A dispatch also ends before a level with an odd side, which only the first
+    // level of a dispatch filters exactly. It needs STORAGE usage and a format with a
+    // storage view the shader can write; sRGB images are written through a UNORM view,
+    // which takes the compute_flags(), and converted in the shader. Other images fall back
+    // to linear blits, which need blit and linear filter support. Views and descriptor
+    // sets made while recording live until retire()'s value has been collect()ed.
+    class mip_generator
+    {
+    public:
+        static constexpr uint32_t MAX_LEVELS_PER_DISPATCH = 6;
+
+        mip_generator() = default;
+        mip_generator(VkDevice device, const physical_device & physical_device, const std::vector<char> & shader_code);
+        void destroy();
+
+        // What an image of this format needs to be created with for the compute path
+        static VkImageUsageFlags compute_usage() { return VK_IMAGE_USAGE_STORAGE_BIT; }
+        static VkImageCreateFlags compute_flags(VkFormat format);
+
+        bool supports(const mip_chain & chain, mip_generation_path path) const;
+        // The preferred path when the chain supports it, the other one otherwise; throws when neither works
+        mip_generation_path path(const mip_chain & chain) const;
+        void set_preferred_path(mip_generation_path path) { preferred = path; }
+
+        // Every level of every chain starts out in initial and ends in the chain's final layout
+        void record(VkCommandBuffer command_buffer, const std::vector<mip_chain> & chains, const resource_state & initial);
+        void retire(uint64_t value);
+        void collect(uint64_t completed_value) { garbage.collect(completed_value); }
+    private:
+        struct dispatch_parameters
+        {
+            int32_t source_width;
+            int32_t source_height;
+            uint32_t level_count;
+            uint32_t srgb;
+        };
+
+        void record_compute(VkCommandBuffer command_buffer, const std::vector<mip_chain> & chains, resource_tracker & tracker);
+        void record_blits(VkCommandBuffer command_buffer, const std::vector<mip_chain> & chains, resource_tracker & tracker);
+        VkImageView create_level_view(const mip_chain & chain, uint32_t level);
+
+        VkDevice vk_device = VK_NULL_HANDLE;
+        VkPhysicalDevice vk_physical_device = VK_NULL_HANDLE;
+        VkDescriptorSetLayout set_layout = VK_NULL_HANDLE;
+        VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        mip_generation_path preferred = mip_generation_path::compute;
+
+        // Made by record() since the last retire()
+        std::vector<VkImageView> recorded_views;
+        std::vector<VkDescriptorPool> recorded_pools;
+        deferred_queue garbage;
+    };
+}
+
+#endif
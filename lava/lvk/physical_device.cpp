@@ -1,5 +1,6 @@
 #include "physical_device.h"
 #include <algorithm>
+#include <cstring>
 
 namespace lvk
 {
@@ -86,6 +87,13 @@ namespace lvk
                 return i;
         throw std::runtime_error("Physical device does not have exclusive queue family");
     }
+    uint32_t physical_device::find_memory_type(uint32_t type_bits, VkMemoryPropertyFlags properties) const
+    {
+        for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++)
+            if ((type_bits & (1 << i)) && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties)
+                return i;
+        throw std::runtime_error("Physical device does not have a suitable memory type");
+    }
     uint32_t physical_device::present_queue_family_index() const
     {
         for (uint32_t i = 0; i < queue_families.size(); i++)
@@ -93,6 +101,13 @@ namespace lvk
                 return i;
         throw std::runtime_error("Physical device does not have present supported queue family");
     }
+    bool physical_device::supports_extension(const char * name) const
+    {
+        for (const auto & extension : extensions)
+            if (std::strcmp(extension.extensionName, name) == 0)
+                return true;
+        return false;
+    }
     bool physical_device::supports_features(VkPhysicalDeviceFeatures requested_features) const
     {
         if ((requested_features.robustBufferAccess && !features.robustBufferAccess) ||
@@ -191,24 +206,64 @@ namespace lvk
         }
         return surf_details.formats[0];
     }
-    VkPresentModeKHR physical_device::choose_swapchain_present_mode() const
+    VkPresentModeKHR physical_device::choose_swapchain_present_mode(present_policy policy) const
     {
+        // Modes in order of preference, FIFO is always supported so it is the implicit fallback
+        std::vector<VkPresentModeKHR> preferred_modes;
+        switch (policy)
+        {
+        case present_policy::low_latency:
+            preferred_modes = { VK_PRESENT_MODE_MAILBOX_KHR };
+            break;
+        case present_policy::max_throughput:
+            preferred_modes = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR };
+            break;
+        case present_policy::vsync_strict:
+            break;
+        case present_policy::vsync_relaxed:
+            preferred_modes = { VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+            break;
+        }
+
         const surface_details surf_details = query_surface_details();
-        for (const auto & mode : surf_details.present_modes)
+        for (auto preferred : preferred_modes)
         {
-            if (mode == VK_PRESENT_MODE_MAILBOX_KHR)
-                return mode;
+            for (const auto & mode : surf_details.present_modes)
+            {
+                if (mode == preferred)
+                    return mode;
+            }
         }
         return VK_PRESENT_MODE_FIFO_KHR;
     }
-    uint32_t physical_device::choose_swapchain_length() const
+    uint32_t physical_device::choose_swapchain_length(present_policy policy) const
     {
         const surface_details surf_details = query_surface_details();
         uint32_t length = surf_details.capabilities.minImageCount + 1;
+
+        // A FIFO queue only adds latency with a spare image, mailbox needs it to always have a free image
+        if (policy == present_policy::low_latency && choose_swapchain_present_mode(policy) == VK_PRESENT_MODE_FIFO_KHR)
+            length = surf_details.capabilities.minImageCount;
+        else if (policy == present_policy::max_throughput)
+            length = std::max(length, 3u);
+
         if (surf_details.capabilities.maxImageCount > 0 && length > surf_details.capabilities.maxImageCount)
             length = surf_details.capabilities.maxImageCount;
         return length;
     }
+    uint32_t physical_device::choose_frames_in_flight(present_policy policy) const
+    {
+        switch (policy)
+        {
+        case present_policy::low_latency:
+            // Mailbox always shows the newest frame, so a second frame in flight never queues behind vblank
+            return choose_swapchain_present_mode(policy) == VK_PRESENT_MODE_MAILBOX_KHR ? 2 : 1;
+        case present_policy::max_throughput:
+            return 3;
+        default:
+            return 2;
+        }
+    }
     const surface_details physical_device::query_surface_details() const
     {
         surface_details details;
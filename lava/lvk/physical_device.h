@@ -15,6 +15,14 @@ namespace lvk
         std::vector<VkPresentModeKHR> present_modes;
     };
 
+    enum class present_policy
+    {
+        low_latency,
+        max_throughput,
+        vsync_strict,
+        vsync_relaxed
+    };
+
     class physical_device : public object<VkPhysicalDevice>
     {
         friend class device_selector;
@@ -34,14 +42,21 @@ namespace lvk
         uint32_t present_queue_family_index() const;
 
         bool supports_features(VkPhysicalDeviceFeatures requested_features) const;
+        bool supports_extension(const char * name) const;
         VkSampleCountFlagBits max_usable_sample_count() const;
+        uint32_t find_memory_type(uint32_t type_bits, VkMemoryPropertyFlags properties) const;
 
         VkExtent2D choose_swapchain_extent(uint32_t width, uint32_t height) const;
         VkSurfaceFormatKHR choose_swapchain_surface_format() const;
-        VkPresentModeKHR choose_swapchain_present_mode() const;
-        uint32_t choose_swapchain_length() const;
+        VkPresentModeKHR choose_swapchain_present_mode(present_policy policy = present_policy::low_latency) const;
+        uint32_t choose_swapchain_length(present_policy policy = present_policy::low_latency) const;
+        uint32_t choose_frames_in_flight(present_policy policy = present_policy::low_latency) const;
 
         const surface_details query_surface_details() const;
+
+        const VkPhysicalDeviceProperties & get_properties() const { return properties; }
+        const VkPhysicalDeviceMemoryProperties & get_memory_properties() const { return memory_properties; }
+        const std::vector<VkQueueFamilyProperties> & get_queue_families() const { return queue_families; }
     private:
         VkSurfaceKHR vk_surface = VK_NULL_HANDLE;
         VkPhysicalDeviceProperties properties = {};
@@ -0,0 +1,595 @@
+#include "render_graph.h"
+#include "host_allocator.h"
+#include "render_pass.h"
+#include "physical_device.h"
+#include "memory_allocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace lvk
+{
+    static constexpr VkAccessFlags WRITE_ACCESS = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    render_graph::pass_builder & render_graph::pass_builder::color(resource image, render_graph_load load, VkClearColorValue clear_value)
+    {
+        image_use use = { image, use_type::color, load, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, {} };
+        use.clear_value.color = clear_value;
+        graph.passes[index].uses.push_back(use);
+        return *this;
+    }
+    render_graph::pass_builder & render_graph::pass_builder::depth(resource image, render_graph_load load, VkClearDepthStencilValue clear_value)
+    {
+        image_use use = { image, use_type::depth, load, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, {} };
+        use.clear_value.depthStencil = clear_value;
+        graph.passes[index].uses.push_back(use);
+        return *this;
+    }
+    render_graph::pass_builder & render_graph::pass_builder::resolve(resource image)
+    {
+        graph.passes[index].uses.push_back({ image, use_type::resolve, render_graph_load::dont_care, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, {} });
+        return *this;
+    }
+    render_graph::pass_builder & render_graph::pass_builder::sampled(resource image, VkPipelineStageFlags stages)
+    {
+        graph.passes[index].uses.push_back({ image, use_type::sampled, render_graph_load::load, stages, {} });
+        return *this;
+    }
+    render_graph::pass_builder & render_graph::pass_builder::side_effects()
+    {
+        graph.passes[index].side_effects = true;
+        return *this;
+    }
+    render_graph::pass_builder & render_graph::pass_builder::contents(VkSubpassContents contents)
+    {
+        graph.passes[index].contents = contents;
+        return *this;
+    }
+
+    render_graph::render_graph(const device & device, const physical_device & physical_device, memory_allocator & allocator)
+        : lvk_device(&device), phys_device(&physical_device), allocator(&allocator)
+    {
+    }
+    void render_graph::destroy()
+    {
+        destroy_resources();
+        for (auto & p : passes)
+        {
+            if (p.render_pass != VK_NULL_HANDLE)
+                vkDestroyRenderPass(lvk_device->vk(), p.render_pass, host_callbacks());
+            p.render_pass = VK_NULL_HANDLE;
+        }
+    }
+    render_graph::resource render_graph::create_image(const std::string & name, VkFormat format, VkSampleCountFlagBits samples, VkImageAspectFlags aspect)
+    {
+        image_resource image = {};
+        image.name = name;
+        image.format = format;
+        image.samples = samples;
+        image.aspect = aspect;
+        image.imported = false;
+        image.initial_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        image.final_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        images.push_back(image);
+        return (resource)(images.size() - 1);
+    }
+    render_graph::resource render_graph::import_image(const std::string & name, VkFormat format, VkSampleCountFlagBits samples, VkImageLayout initial_layout, VkImageLayout final_layout)
+    {
+        resource image = create_image(name, format, samples, VK_IMAGE_ASPECT_COLOR_BIT);
+        images[image].imported = true;
+        images[image].initial_layout = initial_layout;
+        images[image].final_layout = final_layout;
+        return image;
+    }
+    render_graph::pass_builder render_graph::add_pass(const std::string & name)
+    {
+        pass p;
+        p.name = name;
+        passes.push_back(p);
+        return pass_builder(*this, (uint32_t)(passes.size() - 1));
+    }
+    void render_graph::compile()
+    {
+        for (auto & p : passes)
+        {
+            if (p.render_pass != VK_NULL_HANDLE)
+                vkDestroyRenderPass(lvk_device->vk(), p.render_pass, host_callbacks());
+            p.render_pass = VK_NULL_HANDLE;
+        }
+
+        cull_passes();
+        order_passes();
+
+        for (auto & image : images)
+            image.usage = 0;
+        for (uint32_t position = 0; position < order.size(); position++)
+        {
+            for (const auto & use : passes[order[position]].uses)
+            {
+                image_resource & image = images[use.image];
+                if (image.usage == 0)
+                    image.first_use = position;
+                image.last_use = position;
+                image.usage |= use.type == use_type::depth ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT :
+                               use.type == use_type::sampled ? VK_IMAGE_USAGE_SAMPLED_BIT : VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+            }
+        }
+
+        // Contents that never leave a render pass don't need backing memory on tilers. Their stores are
+        // DONT_CARE (see build_render_pass) and their memory is lazily allocated where the device has it.
+        for (uint32_t i = 0; i < images.size(); i++)
+        {
+            bool stored = false;
+            for (uint32_t position = 0; position < order.size(); position++)
+            {
+                const image_use * use = find_use(position, i);
+                const image_use * next = use ? next_use(position, i) : nullptr;
+                if (next && reads_contents(*next))
+                    stored = true;
+            }
+            if (!stored && !images[i].imported && images[i].usage != 0)
+                images[i].usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        }
+
+        alias_memory();
+        for (uint32_t position = 0; position < order.size(); position++)
+            build_render_pass(position);
+    }
+    void render_graph::cull_passes()
+    {
+        // Walk backwards from what leaves the graph; a pass survives if it produces contents someone still needs
+        std::vector<bool> needed(images.size(), false);
+        for (uint32_t i = 0; i < images.size(); i++)
+            needed[i] = images[i].imported;
+
+        for (uint32_t i = (uint32_t)passes.size(); i-- > 0;)
+        {
+            pass & p = passes[i];
+            p.active = p.side_effects;
+            for (const auto & use : p.uses)
+                if (writes(use) && needed[use.image])
+                    p.active = true;
+            if (!p.active)
+                continue;
+
+            for (const auto & use : p.uses)
+                if (writes(use) && !reads_contents(use))
+                    needed[use.image] = false;
+            for (const auto & use : p.uses)
+                if (reads_contents(use))
+                    needed[use.image] = true;
+        }
+    }
+    void render_graph::order_passes()
+    {
+        // A pass depends on every earlier declared pass it shares an image with, unless both only read it
+        std::vector<std::vector<uint32_t>> dependencies(passes.size());
+        for (uint32_t j = 0; j < passes.size(); j++)
+        {
+            if (!passes[j].active)
+                continue;
+            for (uint32_t i = 0; i < j; i++)
+            {
+                if (!passes[i].active)
+                    continue;
+                bool hazard = false;
+                for (const auto & a : passes[i].uses)
+                    for (const auto & b : passes[j].uses)
+                        if (a.image == b.image && (writes(a) || writes(b)))
+                            hazard = true;
+                if (hazard)
+                    dependencies[j].push_back(i);
+            }
+        }
+
+        // Among the ready passes prefer one that doesn't depend on the pass just scheduled, so
+        // consecutive render passes can overlap on the GPU instead of waiting for each other
+        order.clear();
+        std::vector<bool> scheduled(passes.size(), false);
+        for (;;)
+        {
+            int32_t chosen = -1;
+            for (uint32_t i = 0; i < passes.size(); i++)
+            {
+                if (!passes[i].active || scheduled[i])
+                    continue;
+                bool ready = std::all_of(dependencies[i].begin(), dependencies[i].end(), [&](uint32_t d) { return scheduled[d]; });
+                if (!ready)
+                    continue;
+                bool follows_last = !order.empty() &&
+                    std::find(dependencies[i].begin(), dependencies[i].end(), order.back()) != dependencies[i].end();
+                if (chosen < 0)
+                    chosen = (int32_t)i;
+                if (!follows_last)
+                {
+                    chosen = (int32_t)i;
+                    break;
+                }
+            }
+            if (chosen < 0)
+                break;
+            scheduled[chosen] = true;
+            order.push_back((uint32_t)chosen);
+        }
+    }
+    void render_graph::alias_memory()
+    {
+        // Lifetimes are known once the order is fixed, sizes only once the images exist, so
+        // images are grouped here and each group gets the largest requirement of its members
+        blocks.clear();
+
+        // Without a lazily allocated type every block ends up in plain device local memory,
+        // and transient images can share it with stored ones
+        const VkPhysicalDeviceMemoryProperties & properties = phys_device->get_memory_properties();
+        VkMemoryPropertyFlags lazy_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+        bool lazy_memory = false;
+        for (uint32_t t = 0; t < properties.memoryTypeCount; t++)
+            if ((properties.memoryTypes[t].propertyFlags & lazy_flags) == lazy_flags)
+                lazy_memory = true;
+
+        for (uint32_t i = 0; i < images.size(); i++)
+        {
+            image_resource & image = images[i];
+            if (image.imported || image.usage == 0)
+                continue;
+
+            uint32_t chosen = (uint32_t)blocks.size();
+            for (uint32_t b = 0; b < blocks.size() && chosen == blocks.size(); b++)
+            {
+                const image_resource & first = images[blocks[b].images[0]];
+                // Transient images may end up in lazily allocated memory, which nothing else can live in
+                if (first.samples != image.samples || first.aspect != image.aspect ||
+                    (lazy_memory && (first.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) != (image.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT)))
+                    continue;
+                bool overlaps = false;
+                for (resource other : blocks[b].images)
+                    if (images[other].first_use <= image.last_use && image.first_use <= images[other].last_use)
+                        overlaps = true;
+                if (!overlaps)
+                    chosen = b;
+            }
+            if (chosen == blocks.size())
+                blocks.push_back({});
+            blocks[chosen].images.push_back(i);
+            image.memory_block = chosen;
+        }
+    }
+    VkImageLayout render_graph::use_layout(const image_use & use) const
+    {
+        switch (use.type)
+        {
+        case use_type::depth:
+            return VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        case use_type::sampled:
+            return (images[use.image].aspect & VK_IMAGE_ASPECT_DEPTH_BIT) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        default:
+            return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        }
+    }
+    VkAccessFlags render_graph::use_access(const image_use & use) const
+    {
+        switch (use.type)
+        {
+        case use_type::depth:
+            return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        case use_type::sampled:
+            return VK_ACCESS_SHADER_READ_BIT;
+        default:
+            return VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | (use.load == render_graph_load::load ? VK_ACCESS_COLOR_ATTACHMENT_READ_BIT : 0);
+        }
+    }
+    const render_graph::image_use * render_graph::find_use(uint32_t position, resource image) const
+    {
+        for (const auto & use : passes[order[position]].uses)
+            if (use.image == image)
+                return &use;
+        return nullptr;
+    }
+    const render_graph::image_use * render_graph::previous_use(uint32_t position, resource image, uint32_t * found_position) const
+    {
+        // The latest earlier use of any image sharing the memory, wrapping around to the previous frame
+        std::vector<resource> sharing = { image };
+        if (!images[image].imported)
+            sharing = blocks[images[image].memory_block].images;
+
+        for (uint32_t step = 1; step <= order.size(); step++)
+        {
+            uint32_t candidate = (uint32_t)((position + order.size() - step) % order.size());
+            for (resource other : sharing)
+            {
+                const image_use * use = find_use(candidate, other);
+                if (use)
+                {
+                    *found_position = candidate;
+                    return use;
+                }
+            }
+        }
+        return nullptr;
+    }
+    const render_graph::image_use * render_graph::next_use(uint32_t position, resource image) const
+    {
+        for (uint32_t candidate = position + 1; candidate < order.size(); candidate++)
+        {
+            const image_use * use = find_use(candidate, image);
+            if (use)
+                return use;
+        }
+        return nullptr;
+    }
+    void render_graph::build_render_pass(uint32_t position)
+    {
+        pass & p = passes[order[position]];
+        render_pass_builder builder;
+        std::vector<uint32_t> color_indices, depth_indices, resolve_indices;
+        VkPipelineStageFlags src_stages = 0, dst_stages = 0, next_stages = 0;
+        VkAccessFlags src_access = 0, dst_access = 0, next_access = 0, written_access = 0;
+
+        p.attachments.clear();
+        p.clear_values.clear();
+        for (const auto & use : p.uses)
+        {
+            const image_resource & image = images[use.image];
+            dst_stages |= use.stages;
+            dst_access |= use_access(use);
+
+            // Only a previous write needs to be made available, a previous read just has to finish
+            uint32_t previous_position = 0;
+            const image_use * previous = previous_use(position, use.image, &previous_position);
+            if (previous)
+            {
+                src_stages |= previous->stages;
+                src_access |= use_access(*previous) & WRITE_ACCESS;
+            }
+
+            const image_use * next = next_use(position, use.image);
+            if (next && writes(use))
+            {
+                next_stages |= next->stages;
+                next_access |= use_access(*next);
+            }
+            if (writes(use))
+                written_access |= use_access(use) & WRITE_ACCESS;
+
+            if (use.type == use_type::sampled)
+                continue;
+
+            bool in_frame_previous = previous && previous_position < position && find_use(previous_position, use.image) != nullptr;
+            VkAttachmentDescription description = {};
+            description.format = image.format;
+            description.samples = image.samples;
+            description.loadOp = use.load == render_graph_load::clear ? VK_ATTACHMENT_LOAD_OP_CLEAR :
+                                 use.load == render_graph_load::load ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            description.storeOp = (next ? reads_contents(*next) : image.imported) ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+            // Discarded contents can start from UNDEFINED, which also covers memory just handed over by an aliased image
+            description.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            if (use.load == render_graph_load::load)
+            {
+                if (in_frame_previous)
+                    description.initialLayout = writes(*previous) ? use_layout(use) : use_layout(*previous);
+                else if (image.imported)
+                    description.initialLayout = image.initial_layout;
+            }
+            description.finalLayout = next ? use_layout(*next) : image.imported ? image.final_layout : use_layout(use);
+
+            uint32_t attachment = (uint32_t)p.attachments.size();
+            builder.attachment(attachment, description, use_layout(use));
+            p.attachments.push_back(use.image);
+            p.clear_values.push_back(use.clear_value);
+
+            if (use.type == use_type::color)
+                color_indices.push_back(attachment);
+            else if (use.type == use_type::depth)
+                depth_indices.push_back(attachment);
+            else
+                resolve_indices.push_back(attachment);
+        }
+
+        builder.subpass(0, pipeline::bind_point::graphics, color_indices, depth_indices, resolve_indices);
+        builder.subpass_dependency(VK_SUBPASS_EXTERNAL, 0, src_stages ? src_stages : (VkPipelineStageFlags)VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, src_access, dst_stages, dst_access);
+        if (next_stages != 0)
+            builder.subpass_dependency(0, VK_SUBPASS_EXTERNAL, dst_stages, written_access, next_stages, next_access);
+        p.render_pass = builder.build(*lvk_device).vk();
+    }
+    void render_graph::bind_imported(resource image, const std::vector<VkImageView> & views)
+    {
+        images[image].imported_views = views;
+    }
+    void render_graph::create_resources(VkExtent2D extent)
+    {
+        VkDevice device = lvk_device->vk();
+        resource_extent = extent;
+        stats = {};
+
+        frame_count = 1;
+        for (const auto & image : images)
+            if (image.imported)
+                frame_count = std::max(frame_count, (uint32_t)image.imported_views.size());
+
+        for (auto & block : blocks)
+        {
+            block.size = 0;
+            block.alignment = 1;
+            block.type_bits = ~0u;
+            for (resource i : block.images)
+            {
+                image_resource & image = images[i];
+                VkImageCreateInfo info = {};
+                info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+                info.imageType = VK_IMAGE_TYPE_2D;
+                info.extent = { extent.width, extent.height, 1 };
+                info.mipLevels = 1;
+                info.arrayLayers = 1;
+                info.format = image.format;
+                info.tiling = VK_IMAGE_TILING_OPTIMAL;
+                info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                info.usage = image.usage;
+                info.samples = image.samples;
+                info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+                if (vkCreateImage(device, &info, host_callbacks(), &image.image) != VK_SUCCESS)
+                    throw std::runtime_error("Failed to create render graph image " + image.name);
+
+                VkMemoryRequirements requirements;
+                vkGetImageMemoryRequirements(device, image.image, &requirements);
+                block.size = std::max(block.size, requirements.size);
+                block.alignment = std::max(block.alignment, requirements.alignment);
+                block.type_bits &= requirements.memoryTypeBits;
+                stats.required += requirements.size;
+                stats.images++;
+            }
+            if (block.type_bits == 0)
+                throw std::runtime_error("Aliased render graph images have no memory type in common");
+
+            // Desktop GPUs usually have no lazily allocated type, and the block falls back to plain device local memory
+            // Only a block of nothing but transient images can be lazily allocated
+            uint32_t memory_type = ~0u;
+            bool transient = true;
+            for (resource i : block.images)
+                if (!(images[i].usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT))
+                    transient = false;
+            if (transient)
+            {
+                const VkPhysicalDeviceMemoryProperties & properties = phys_device->get_memory_properties();
+                VkMemoryPropertyFlags lazy_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+                for (uint32_t t = 0; t < properties.memoryTypeCount && memory_type == ~0u; t++)
+                    if ((block.type_bits & (1u << t)) && (properties.memoryTypes[t].propertyFlags & lazy_flags) == lazy_flags)
+                        memory_type = t;
+            }
+            block.lazy = memory_type != ~0u;
+            if (!block.lazy)
+                memory_type = phys_device->find_memory_type(block.type_bits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+            VkMemoryAllocateInfo alloc_info = {};
+            alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            alloc_info.allocationSize = block.size;
+            alloc_info.memoryTypeIndex = memory_type;
+
+            if (vkAllocateMemory(device, &alloc_info, host_callbacks(), &block.memory) != VK_SUCCESS)
+                throw std::runtime_error("Failed to allocate render graph memory");
+            block.memory_type = memory_type;
+            // Lazily allocated memory is mostly never committed, only real blocks count towards the budget
+            if (!block.lazy)
+                allocator->add_external_usage(memory_type, block.size);
+            stats.allocated += block.size;
+            stats.blocks++;
+            if (block.lazy)
+            {
+                stats.lazy += block.size;
+                stats.lazy_blocks++;
+            }
+
+            for (resource i : block.images)
+            {
+                image_resource & image = images[i];
+                vkBindImageMemory(device, image.image, block.memory, 0);
+
+                VkImageViewCreateInfo view_info = {};
+                view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+                view_info.image = image.image;
+                view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+                view_info.format = image.format;
+                view_info.subresourceRange.aspectMask = image.aspect;
+                view_info.subresourceRange.levelCount = 1;
+                view_info.subresourceRange.layerCount = 1;
+
+                if (vkCreateImageView(device, &view_info, host_callbacks(), &image.view) != VK_SUCCESS)
+                    throw std::runtime_error("Failed to create render graph image view " + image.name);
+            }
+        }
+
+        for (uint32_t pass_index : order)
+        {
+            pass & p = passes[pass_index];
+            p.framebuffers.resize(frame_count);
+            for (uint32_t frame = 0; frame < frame_count; frame++)
+            {
+                std::vector<VkImageView> views;
+                for (resource i : p.attachments)
+                    views.push_back(images[i].imported ? images[i].imported_views[frame % images[i].imported_views.size()] : images[i].view);
+
+                VkFramebufferCreateInfo info = {};
+                info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+                info.renderPass = p.render_pass;
+                info.attachmentCount = (uint32_t)views.size();
+                info.pAttachments = views.data();
+                info.width = extent.width;
+                info.height = extent.height;
+                info.layers = 1;
+
+                if (vkCreateFramebuffer(device, &info, host_callbacks(), &p.framebuffers[frame]) != VK_SUCCESS)
+                    throw std::runtime_error("Failed to create render graph framebuffer for " + p.name);
+            }
+        }
+    }
+    void render_graph::destroy_resources()
+    {
+        if (lvk_device == nullptr)
+            return;
+
+        VkDevice device = lvk_device->vk();
+        for (auto & p : passes)
+        {
+            for (auto framebuffer : p.framebuffers)
+                vkDestroyFramebuffer(device, framebuffer, host_callbacks());
+            p.framebuffers.clear();
+        }
+        for (auto & image : images)
+        {
+            if (image.view != VK_NULL_HANDLE)
+                vkDestroyImageView(device, image.view, host_callbacks());
+            if (image.image != VK_NULL_HANDLE)
+                vkDestroyImage(device, image.image, host_callbacks());
+            image.view = VK_NULL_HANDLE;
+            image.image = VK_NULL_HANDLE;
+        }
+        for (auto & block : blocks)
+        {
+            if (block.memory != VK_NULL_HANDLE)
+            {
+                vkFreeMemory(device, block.memory, host_callbacks());
+                if (!block.lazy)
+                    allocator->remove_external_usage(block.memory_type, block.size);
+            }
+            block.memory = VK_NULL_HANDLE;
+        }
+    }
+    render_graph_memory_stats render_graph::memory_stats() const
+    {
+        render_graph_memory_stats result = stats;
+        result.lazy_committed = 0;
+        for (const auto & block : blocks)
+        {
+            if (!block.lazy || block.memory == VK_NULL_HANDLE)
+                continue;
+            VkDeviceSize committed = 0;
+            vkGetDeviceMemoryCommitment(lvk_device->vk(), block.memory, &committed);
+            result.lazy_committed += committed;
+        }
+        return result;
+    }
+    void render_graph::record(VkCommandBuffer command_buffer, uint32_t frame, const pass_recorder & record_pass) const
+    {
+        for (uint32_t pass_index : order)
+        {
+            const pass & p = passes[pass_index];
+            render_graph_pass_info info = { pass_index, &p.name, p.render_pass, p.framebuffers[frame % frame_count], resource_extent };
+
+            VkRenderPassBeginInfo begin_info = {};
+            begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            begin_info.renderPass = p.render_pass;
+            begin_info.framebuffer = info.framebuffer;
+            begin_info.renderArea.offset = { 0, 0 };
+            begin_info.renderArea.extent = resource_extent;
+            begin_info.clearValueCount = (uint32_t)p.clear_values.size();
+            begin_info.pClearValues = p.clear_values.data();
+
+            vkCmdBeginRenderPass(command_buffer, &begin_info, p.contents);
+            record_pass(command_buffer, info);
+            vkCmdEndRenderPass(command_buffer);
+        }
+    }
+}
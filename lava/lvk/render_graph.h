@@ -0,0 +1,185 @@
+#ifndef LVK_RENDER_GRAPH_H
+#define LVK_RENDER_GRAPH_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <functional>
+
+namespace lvk
+{
+    class device;
+    class physical_device;
+    class memory_allocator;
+
+    enum class render_graph_load
+    {
+        clear,
+        load,
+        dont_care
+    };
+
+    struct render_graph_pass_info
+    {
+        uint32_t pass;
+        const std::string * name;
+        VkRenderPass render_pass;
+        VkFramebuffer framebuffer;
+        VkExtent2D extent;
+    };
+
+    struct render_graph_memory_stats
+    {
+        VkDeviceSize required = 0;      // Sum of every transient image on its own
+        VkDeviceSize allocated = 0;     // What was actually allocated after aliasing
+        VkDeviceSize lazy = 0;          // Part of allocated in lazily allocated memory
+        VkDeviceSize lazy_committed = 0;// What the driver has actually backed of that so far
+        uint32_t images = 0;
+        uint32_t blocks = 0;
+        uint32_t lazy_blocks = 0;
+
+        // Bytes not backed compared to giving every transient image its own device local memory
+        VkDeviceSize saved() const { return required - (allocated - lazy) - lazy_committed; }
+    };
+
+    // Frame level render graph. Passes declare the images they render to and sample, in
+    // the order they would naturally run. compile() culls passes that nothing visible
+    // depends on, orders the rest and builds one render pass per graph pass whose load and
+    // store ops, layouts and external dependencies are derived from the neighbouring uses
+    // of every image, so no separate barriers are recorded. Transient images are created
+    // by the graph, and images whose lifetimes don't overlap share memory.
+    class render_graph
+    {
+    public:
+        using resource = uint32_t;
+        using pass_recorder = std::function<void(VkCommandBuffer command_buffer, const render_graph_pass_info & info)>;
+
+        class pass_builder
+        {
+        public:
+            pass_builder & color(resource image, render_graph_load load, VkClearColorValue clear_value = {});
+            pass_builder & depth(resource image, render_graph_load load, VkClearDepthStencilValue clear_value = { 1.0f, 0 });
+            pass_builder & resolve(resource image);
+            pass_builder & sampled(resource image, VkPipelineStageFlags stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+            // Kept even if none of its outputs are used
+            pass_builder & side_effects();
+            pass_builder & contents(VkSubpassContents contents);
+
+            uint32_t id() const { return index; }
+        private:
+            friend class render_graph;
+            pass_builder(render_graph & graph, uint32_t index) : graph(graph), index(index) { }
+
+            render_graph & graph;
+            uint32_t index;
+        };
+
+        render_graph() = default;
+        // Attachment memory is allocated directly but reported to the allocator's heap usage
+        render_graph(const device & device, const physical_device & physical_device, memory_allocator & allocator);
+        void destroy();
+
+        resource create_image(const std::string & name, VkFormat format, VkSampleCountFlagBits samples, VkImageAspectFlags aspect);
+        // An image owned elsewhere, one view per frame (usually the swapchain images)
+        resource import_image(const std::string & name, VkFormat format, VkSampleCountFlagBits samples, VkImageLayout initial_layout, VkImageLayout final_layout);
+        pass_builder add_pass(const std::string & name);
+
+        // Render passes only depend on formats, so they survive create_resources/destroy_resources
+        void compile();
+        void bind_imported(resource image, const std::vector<VkImageView> & views);
+        void create_resources(VkExtent2D extent);
+        void destroy_resources();
+
+        void record(VkCommandBuffer command_buffer, uint32_t frame, const pass_recorder & record_pass) const;
+
+        bool pass_active(uint32_t pass) const { return passes[pass].active; }
+        VkRenderPass pass_render_pass(uint32_t pass) const { return passes[pass].render_pass; }
+        VkFramebuffer framebuffer(uint32_t pass, uint32_t frame) const { return passes[pass].framebuffers[frame]; }
+        const std::vector<uint32_t> & execution_order() const { return order; }
+        // Queries how much of the lazily allocated memory is committed, which can grow while rendering
+        render_graph_memory_stats memory_stats() const;
+    private:
+        enum class use_type
+        {
+            color,
+            depth,
+            resolve,
+            sampled
+        };
+        struct image_use
+        {
+            resource image;
+            use_type type;
+            render_graph_load load;
+            VkPipelineStageFlags stages;
+            VkClearValue clear_value;
+        };
+        struct image_resource
+        {
+            std::string name;
+            VkFormat format;
+            VkSampleCountFlagBits samples;
+            VkImageAspectFlags aspect;
+            bool imported;
+            VkImageLayout initial_layout;
+            VkImageLayout final_layout;
+            std::vector<VkImageView> imported_views;
+
+            VkImageUsageFlags usage = 0;
+            uint32_t first_use = 0;
+            uint32_t last_use = 0;
+            VkImage image = VK_NULL_HANDLE;
+            VkImageView view = VK_NULL_HANDLE;
+            uint32_t memory_block = 0;
+        };
+        struct pass
+        {
+            std::string name;
+            std::vector<image_use> uses;
+            bool side_effects = false;
+            VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE;
+
+            bool active = false;
+            VkRenderPass render_pass = VK_NULL_HANDLE;
+            std::vector<resource> attachments;
+            std::vector<VkClearValue> clear_values;
+            std::vector<VkFramebuffer> framebuffers;
+        };
+        struct memory_block
+        {
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkDeviceSize size = 0;
+            VkDeviceSize alignment = 1;
+            uint32_t type_bits = ~0u;
+            uint32_t memory_type = 0;
+            bool lazy = false;
+            std::vector<resource> images;
+        };
+
+        static bool writes(const image_use & use) { return use.type != use_type::sampled; }
+        static bool reads_contents(const image_use & use) { return use.type == use_type::sampled || use.load == render_graph_load::load; }
+        VkImageLayout use_layout(const image_use & use) const;
+        VkAccessFlags use_access(const image_use & use) const;
+
+        void cull_passes();
+        void order_passes();
+        void build_render_pass(uint32_t pass_index);
+        const image_use * find_use(uint32_t position, resource image) const;
+        const image_use * previous_use(uint32_t position, resource image, uint32_t * found_position) const;
+        const image_use * next_use(uint32_t position, resource image) const;
+        void alias_memory();
+
+        const device * lvk_device = nullptr;
+        const physical_device * phys_device = nullptr;
+        memory_allocator * allocator = nullptr;
+        std::vector<image_resource> images;
+        std::vector<pass> passes;
+        std::vector<uint32_t> order;
+        std::vector<memory_block> blocks;
+        VkExtent2D resource_extent = {};
+        uint32_t frame_count = 1;
+        render_graph_memory_stats stats;
+    };
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include "render_pass.h"
+#include "host_allocator.h"
 #include <algorithm>
 #include <iterator>
 
@@ -47,6 +48,16 @@ namespace lvk
         attachment_refs[index] = reference;
         return *this;
     }
+    render_pass_builder & render_pass_builder::attachment(uint32_t index, const VkAttachmentDescription & description, VkImageLayout subpass_layout)
+    {
+        VkAttachmentReference reference = {};
+        reference.attachment = index;
+        reference.layout = subpass_layout;
+
+        attachments[index] = description;
+        attachment_refs[index] = reference;
+        return *this;
+    }
     render_pass_builder & render_pass_builder::subpass(uint32_t index, pipeline::bind_point bind_point, std::vector<uint32_t> color_indices, std::vector<uint32_t> depth_indices, std::vector<uint32_t> resolve_indices)
     {
         subpass_description description = {};
@@ -59,10 +70,11 @@ namespace lvk
         for (size_t i = 0; i < color_indices.size(); i++)
         {
             description.color_references[i] = attachment_refs[color_indices[i]];
-            description.depth_references[i] = attachment_refs[depth_indices[i]];
             if (!resolve_indices.empty())
                 description.resolve_references[i] = attachment_refs[resolve_indices[i]];
         }
+        for (size_t i = 0; i < depth_indices.size(); i++)
+            description.depth_references[i] = attachment_refs[depth_indices[i]];
         subpasses[index] = description;
         return *this;
     }
@@ -78,6 +90,18 @@ namespace lvk
         subpass_dependencies.emplace_back(dependency);
         return *this;
     }
+    render_pass_builder & render_pass_builder::subpass_dependency(uint32_t src_subpass, uint32_t dst_subpass, VkPipelineStageFlags src_stages, VkAccessFlags src_access, VkPipelineStageFlags dst_stages, VkAccessFlags dst_access)
+    {
+        VkSubpassDependency dependency = {};
+        dependency.srcSubpass = src_subpass;
+        dependency.dstSubpass = dst_subpass;
+        dependency.srcStageMask = src_stages;
+        dependency.srcAccessMask = src_access;
+        dependency.dstStageMask = dst_stages;
+        dependency.dstAccessMask = dst_access;
+        subpass_dependencies.emplace_back(dependency);
+        return *this;
+    }
     render_pass render_pass_builder::build(const device & device)
     {
         VkRenderPassCreateInfo create_info = {};
@@ -119,7 +143,7 @@ namespace lvk
 
     render_pass::render_pass(VkDevice device, VkRenderPassCreateInfo create_info)
     {
-        if (vkCreateRenderPass(device, &create_info, nullptr, &vk_object) != VK_SUCCESS)
+        if (vkCreateRenderPass(device, &create_info, host_callbacks(), &vk_object) != VK_SUCCESS)
             throw std::runtime_error("Failed to create render pass");
     }
 }
\ No newline at end of file
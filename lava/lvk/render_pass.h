@@ -57,7 +57,7 @@ namespace lvk
             desc.pipelineBindPoint = (VkPipelineBindPoint)pipeline_bind_point;
             desc.colorAttachmentCount = color_references.size();
             desc.pColorAttachments = color_references.data();
-            desc.pDepthStencilAttachment = depth_references.data();
+            desc.pDepthStencilAttachment = depth_references.empty() ? nullptr : depth_references.data();
             if (!resolve_references.empty())
                 desc.pResolveAttachments = resolve_references.data();
             return desc;
@@ -70,8 +70,10 @@ namespace lvk
         render_pass_builder();
 
         render_pass_builder & attachment(uint32_t index, attachment::type type, VkFormat format, VkSampleCountFlagBits samples);
+        render_pass_builder & attachment(uint32_t index, const VkAttachmentDescription & description, VkImageLayout subpass_layout);
         render_pass_builder & subpass(uint32_t index, pipeline::bind_point bind_point, std::vector<uint32_t> color_indices, std::vector<uint32_t> depth_indices, std::vector<uint32_t> resolve_indices);
         render_pass_builder & subpass_dependency(uint32_t src_subpass, uint32_t dst_subpass, pipeline::stage src_stages, access src_access, pipeline::stage dst_stages, access dst_access);
+        render_pass_builder & subpass_dependency(uint32_t src_subpass, uint32_t dst_subpass, VkPipelineStageFlags src_stages, VkAccessFlags src_access, VkPipelineStageFlags dst_stages, VkAccessFlags dst_access);
 
         render_pass build(const device & device);
     private:
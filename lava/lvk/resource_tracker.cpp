@@ -0,0 +1,261 @@
+#include "resource_tracker.h"
+
+#include <stdexcept>
+
+namespace lvk
+{
+    static constexpr VkAccessFlags WRITE_ACCESS = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                                  VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT |
+                                                  VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+    void resource_tracker::track_image(VkImage image, VkImageAspectFlags aspect, uint32_t mip_levels, uint32_t array_layers, const resource_state & initial)
+    {
+        tracked_image & tracked = images[image];
+        tracked.aspect = aspect;
+        tracked.mip_levels = mip_levels;
+        tracked.array_layers = array_layers;
+        tracked.subresources.assign(mip_levels * array_layers, initial_state(initial));
+    }
+    void resource_tracker::track_buffer(VkBuffer buffer, VkDeviceSize size, const resource_state & initial)
+    {
+        buffers[buffer] = { { 0, size, initial_state(initial) } };
+    }
+    void resource_tracker::forget(VkImage image)
+    {
+        images.erase(image);
+    }
+    void resource_tracker::forget(VkBuffer buffer)
+    {
+        buffers.erase(buffer);
+    }
+    void resource_tracker::use_image(VkImage image, uint32_t base_mip, uint32_t mip_count, VkPipelineStageFlags stages, VkAccessFlags access, VkImageLayout layout)
+    {
+        const tracked_image & tracked = images.at(image);
+        VkImageSubresourceRange range = {};
+        range.aspectMask = tracked.aspect;
+        range.baseMipLevel = base_mip;
+        range.levelCount = mip_count;
+        range.baseArrayLayer = 0;
+        range.layerCount = tracked.array_layers;
+        use_image(image, range, stages, access, layout);
+    }
+    void resource_tracker::use_image(VkImage image, const VkImageSubresourceRange & range, VkPipelineStageFlags stages, VkAccessFlags access, VkImageLayout layout)
+    {
+        tracked_image & tracked = images.at(image);
+        uint32_t mip_end = range.levelCount == VK_REMAINING_MIP_LEVELS ? tracked.mip_levels : range.baseMipLevel + range.levelCount;
+        uint32_t layer_end = range.layerCount == VK_REMAINING_ARRAY_LAYERS ? tracked.array_layers : range.baseArrayLayer + range.layerCount;
+
+        for (uint32_t layer = range.baseArrayLayer; layer < layer_end; layer++)
+        {
+            for (uint32_t mip = range.baseMipLevel; mip < mip_end; mip++)
+            {
+                VkPipelineStageFlags src_stages = 0;
+                VkAccessFlags src_access = 0;
+                VkImageLayout old_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+                if (!transition(tracked.subresources[layer * tracked.mip_levels + mip], stages, access, layout, src_stages, src_access, old_layout))
+                    continue;
+
+                pending_src_stages |= src_stages ? src_stages : (VkPipelineStageFlags)VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+                pending_dst_stages |= stages;
+
+                // Consecutive mip levels coming from the same state share one barrier
+                if (!image_barriers.empty())
+                {
+                    VkImageMemoryBarrier & last = image_barriers.back();
+                    if (last.image == image && last.oldLayout == old_layout && last.newLayout == layout &&
+                        last.srcAccessMask == src_access && last.dstAccessMask == access &&
+                        last.subresourceRange.baseArrayLayer == layer && last.subresourceRange.baseMipLevel + last.subresourceRange.levelCount == mip)
+                    {
+                        last.subresourceRange.levelCount++;
+                        continue;
+                    }
+                }
+
+                VkImageMemoryBarrier barrier = {};
+                barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                barrier.srcAccessMask = src_access;
+                barrier.dstAccessMask = access;
+                barrier.oldLayout = old_layout;
+                barrier.newLayout = layout;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.image = image;
+                barrier.subresourceRange.aspectMask = range.aspectMask;
+                barrier.subresourceRange.baseMipLevel = mip;
+                barrier.subresourceRange.levelCount = 1;
+                barrier.subresourceRange.baseArrayLayer = layer;
+                barrier.subresourceRange.layerCount = 1;
+                image_barriers.push_back(barrier);
+            }
+        }
+    }
+    void resource_tracker::use_buffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, VkPipelineStageFlags stages, VkAccessFlags access)
+    {
+        std::vector<buffer_range> & ranges = buffers.at(buffer);
+        VkDeviceSize end = size == VK_WHOLE_SIZE ? ranges.back().offset + ranges.back().size : offset + size;
+        split_buffer(ranges, offset);
+        split_buffer(ranges, end);
+
+        for (auto & range : ranges)
+        {
+            if (range.offset < offset || range.offset + range.size > end)
+                continue;
+
+            VkPipelineStageFlags src_stages = 0;
+            VkAccessFlags src_access = 0;
+            VkImageLayout old_layout;
+            if (!transition(range.state, stages, access, VK_IMAGE_LAYOUT_UNDEFINED, src_stages, src_access, old_layout))
+                continue;
+
+            pending_src_stages |= src_stages ? src_stages : (VkPipelineStageFlags)VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+            pending_dst_stages |= stages;
+
+            if (!buffer_barriers.empty())
+            {
+                VkBufferMemoryBarrier & last = buffer_barriers.back();
+                if (last.buffer == buffer && last.srcAccessMask == src_access && last.dstAccessMask == access && last.offset + last.size == range.offset)
+                {
+                    last.size += range.size;
+                    continue;
+                }
+            }
+
+            VkBufferMemoryBarrier barrier = {};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = src_access;
+            barrier.dstAccessMask = access;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.buffer = buffer;
+            barrier.offset = range.offset;
+            barrier.size = range.size;
+            buffer_barriers.push_back(barrier);
+        }
+
+        // Neighbours that ended up in the same state collapse again, so ranges don't fragment forever
+        std::vector<buffer_range> merged;
+        for (const auto & range : ranges)
+        {
+            if (!merged.empty())
+            {
+                const tracked_state & a = merged.back().state;
+                const tracked_state & b = range.state;
+                if (a.write_stages == b.write_stages && a.write_access == b.write_access && a.read_stages == b.read_stages &&
+                    a.visible_stages == b.visible_stages && a.visible_access == b.visible_access && a.barrier_epoch == b.barrier_epoch)
+                {
+                    merged.back().size += range.size;
+                    continue;
+                }
+            }
+            merged.push_back(range);
+        }
+        ranges.swap(merged);
+    }
+    void resource_tracker::flush(VkCommandBuffer command_buffer)
+    {
+        if (!has_pending())
+            return;
+
+        vkCmdPipelineBarrier(command_buffer, pending_src_stages, pending_dst_stages, 0, 0, nullptr,
+                             (uint32_t)buffer_barriers.size(), buffer_barriers.data(), (uint32_t)image_barriers.size(), image_barriers.data());
+
+        flush_count++;
+        barrier_count += buffer_barriers.size() + image_barriers.size();
+        buffer_barriers.clear();
+        image_barriers.clear();
+        pending_src_stages = 0;
+        pending_dst_stages = 0;
+        epoch++;
+    }
+    VkImageLayout resource_tracker::layout(VkImage image, uint32_t mip_level, uint32_t array_layer) const
+    {
+        const tracked_image & tracked = images.at(image);
+        return tracked.subresources[array_layer * tracked.mip_levels + mip_level].layout;
+    }
+    resource_tracker::tracked_state resource_tracker::initial_state(const resource_state & initial)
+    {
+        // The use it is synchronised with counts as the last write, already visible to that use
+        tracked_state state;
+        state.layout = initial.layout;
+        state.write_stages = initial.stages;
+        state.visible_stages = initial.stages;
+        state.visible_access = initial.access;
+        return state;
+    }
+    bool resource_tracker::transition(tracked_state & state, VkPipelineStageFlags stages, VkAccessFlags access, VkImageLayout layout,
+                                      VkPipelineStageFlags & src_stages, VkAccessFlags & src_access, VkImageLayout & old_layout)
+    {
+        VkAccessFlags writes = access & WRITE_ACCESS;
+        bool needed;
+        old_layout = state.layout;
+
+        if (layout != state.layout || writes != 0)
+        {
+            // Layout transitions and writes wait for the last write and for every read since. A write is free only
+            // when nothing read the resource and the last write is already visible to it, or when nothing ever
+            // touched it, which is what a fresh resource without a layout to change looks like.
+            bool fresh = state.write_stages == 0 && state.read_stages == 0;
+            bool write_visible = fresh || (state.write_access == 0 && (stages & ~state.visible_stages) == 0);
+            needed = layout != state.layout || state.read_stages != 0 || !write_visible;
+            src_stages = state.write_stages | state.read_stages;
+            src_access = state.write_access;
+
+            if (writes != 0)
+            {
+                state.write_stages = stages;
+                state.write_access = writes;
+                state.read_stages = 0;
+                state.visible_stages = 0;
+                state.visible_access = 0;
+            }
+            else
+            {
+                // The transition itself is the last write, and the barrier makes it visible to this use
+                state.write_stages = stages;
+                state.write_access = 0;
+                state.read_stages = stages;
+                state.visible_stages = stages;
+                state.visible_access = access;
+            }
+            state.layout = layout;
+        }
+        else
+        {
+            // Reads after reads are free as long as the last write was made visible to them
+            bool visible = (stages & ~state.visible_stages) == 0 && (access & ~state.visible_access) == 0;
+            needed = state.write_stages != 0 && !visible;
+            src_stages = state.write_stages;
+            src_access = state.write_access;
+            if (needed)
+            {
+                state.visible_stages |= stages;
+                state.visible_access |= access;
+            }
+            state.read_stages |= stages;
+        }
+
+        if (needed)
+        {
+            if (state.barrier_epoch == epoch)
+                throw std::logic_error("Resource used twice without flushing the tracker in between");
+            state.barrier_epoch = epoch;
+        }
+        return needed;
+    }
+    void resource_tracker::split_buffer(std::vector<buffer_range> & ranges, VkDeviceSize at)
+    {
+        for (size_t i = 0; i < ranges.size(); i++)
+        {
+            buffer_range & range = ranges[i];
+            if (at <= range.offset || at >= range.offset + range.size)
+                continue;
+
+            buffer_range tail = range;
+            tail.offset = at;
+            tail.size = range.offset + range.size - at;
+            range.size = at - range.offset;
+            ranges.insert(ranges.begin() + i + 1, tail);
+            return;
+        }
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef LVK_RESOURCE_TRACKER_H
+#define LVK_RESOURCE_TRACKER_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <unordered_map>
+
+namespace lvk
+{
+    // Where a resource was last used. For an image this is the layout the subresource is in.
+    struct resource_state
+    {
+        VkPipelineStageFlags stages = 0;
+        VkAccessFlags access = 0;
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    };
+
+    // Tracks the last writer, the readers since then and the layout of every image
+    // subresource and buffer range used on one queue. Declaring a use queues only the
+    // barriers that use actually needs (layout changes, read/write-after-write and
+    // write-after-read); flush() records everything queued as a single
+    // vkCmdPipelineBarrier, merging adjacent mip levels and buffer ranges. Uses that depend
+    // on each other must be separated by a flush.
+    class resource_tracker
+    {
+    public:
+        // initial describes the use the resource is already synchronised with, if any
+        void track_image(VkImage image, VkImageAspectFlags aspect, uint32_t mip_levels, uint32_t array_layers, const resource_state & initial = {});
+        void track_buffer(VkBuffer buffer, VkDeviceSize size, const resource_state & initial = {});
+        void forget(VkImage image);
+        void forget(VkBuffer buffer);
+
+        void use_image(VkImage image, uint32_t base_mip, uint32_t mip_count, VkPipelineStageFlags stages, VkAccessFlags access, VkImageLayout layout);
+        void use_image(VkImage image, const VkImageSubresourceRange & range, VkPipelineStageFlags stages, VkAccessFlags access, VkImageLayout layout);
+        void use_buffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, VkPipelineStageFlags stages, VkAccessFlags access);
+        void flush(VkCommandBuffer command_buffer);
+
+        bool has_pending() const { return !image_barriers.empty() || !buffer_barriers.empty() || pending_src_stages != 0; }
+        VkImageLayout layout(VkImage image, uint32_t mip_level, uint32_t array_layer = 0) const;
+
+        uint64_t barrier_commands() const { return flush_count; }
+        uint64_t barriers() const { return barrier_count; }
+    private:
+        struct tracked_state
+        {
+            VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            VkPipelineStageFlags write_stages = 0;
+            VkAccessFlags write_access = 0;
+            VkPipelineStageFlags read_stages = 0;
+            VkPipelineStageFlags visible_stages = 0;
+            VkAccessFlags visible_access = 0;
+            uint64_t barrier_epoch = 0;
+        };
+        struct tracked_image
+        {
+            VkImageAspectFlags aspect;
+            uint32_t mip_levels;
+            uint32_t array_layers;
+            std::vector<tracked_state> subresources;
+        };
+        struct buffer_range
+        {
+            VkDeviceSize offset;
+            VkDeviceSize size;
+            tracked_state state;
+        };
+
+        static tracked_state initial_state(const resource_state & initial);
+        // Returns true and fills src if the use needs a barrier, and moves state past the use
+        bool transition(tracked_state & state, VkPipelineStageFlags stages, VkAccessFlags access, VkImageLayout layout,
+                        VkPipelineStageFlags & src_stages, VkAccessFlags & src_access, VkImageLayout & old_layout);
+        void split_buffer(std::vector<buffer_range> & ranges, VkDeviceSize at);
+
+        std::unordered_map<VkImage, tracked_image> images;
+        std::unordered_map<VkBuffer, std::vector<buffer_range>> buffers;
+
+        std::vector<VkImageMemoryBarrier> image_barriers;
+        std::vector<VkBufferMemoryBarrier> buffer_barriers;
+        VkPipelineStageFlags pending_src_stages = 0;
+        VkPipelineStageFlags pending_dst_stages = 0;
+        uint64_t epoch = 1;
+        uint64_t flush_count = 0;
+        uint64_t barrier_count = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,60 @@
+#include "ring_buffer.h"
+#include "host_allocator.h"
+#include "physical_device.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace lvk
+{
+    ring_buffer::ring_buffer(VkDevice device, const physical_device & physical_device, memory_allocator & allocator, VkBufferUsageFlags usage,
+                             VkDeviceSize region_size, uint32_t region_count)
+        : vk_device(device), allocator(&allocator)
+    {
+        // Every allocation has to be usable as a dynamic offset for whichever descriptor types the buffer backs
+        const VkPhysicalDeviceLimits & limits = physical_device.get_properties().limits;
+        if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+            offset_alignment = std::max(offset_alignment, limits.minUniformBufferOffsetAlignment);
+        if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+            offset_alignment = std::max(offset_alignment, limits.minStorageBufferOffsetAlignment);
+        this->region_size = (region_size + offset_alignment - 1) / offset_alignment * offset_alignment;
+
+        VkBufferCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        info.size = this->region_size * region_count;
+        info.usage = usage;
+        info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateBuffer(vk_device, &info, host_callbacks(), &buffer) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create ring buffer");
+        memory = allocator.allocate_buffer(buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    }
+    void ring_buffer::destroy()
+    {
+        if (buffer == VK_NULL_HANDLE)
+            return;
+        vkDestroyBuffer(vk_device, buffer, host_callbacks());
+        allocator->free(memory);
+        buffer = VK_NULL_HANDLE;
+    }
+    void ring_buffer::begin_region(uint32_t region)
+    {
+        current_region = region;
+        head = 0;
+    }
+    ring_allocation ring_buffer::allocate(VkDeviceSize size)
+    {
+        VkDeviceSize offset = head;
+        VkDeviceSize end = offset + size;
+        if (end > region_size)
+            throw std::runtime_error("Ring buffer region is full");
+        head = std::min(region_size, (end + offset_alignment - 1) / offset_alignment * offset_alignment);
+        peak_usage = std::max(peak_usage, end);
+
+        ring_allocation result;
+        result.buffer = buffer;
+        result.offset = region_offset(current_region) + offset;
+        result.mapped = (char *)memory.mapped + result.offset;
+        return result;
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef LVK_RING_BUFFER_H
+#define LVK_RING_BUFFER_H
+
+#include <vulkan/vulkan.h>
+#include <cstring>
+
+#include "memory_allocator.h"
+
+namespace lvk
+{
+    class physical_device;
+
+    struct ring_allocation
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        void * mapped = nullptr;
+    };
+
+    // One persistently mapped host visible buffer split into equal regions, one per frame
+    // slot or swapchain image. Transient data for a frame is bump allocated from its region
+    // and bound with dynamic offsets. begin_region() rewinds a region, so it must only be
+    // called once the GPU work that read the region's previous contents has completed.
+    // Allocations are handed out in order from the start of the region, so the first one is
+    // always at region_offset().
+    class ring_buffer
+    {
+    public:
+        ring_buffer() = default;
+        ring_buffer(VkDevice device, const physical_device & physical_device, memory_allocator & allocator, VkBufferUsageFlags usage,
+                    VkDeviceSize region_size, uint32_t region_count);
+        void destroy();
+
+        void begin_region(uint32_t region);
+        ring_allocation allocate(VkDeviceSize size);
+        template <typename T>
+        ring_allocation push(const T & value)
+        {
+            ring_allocation result = allocate(sizeof(T));
+            std::memcpy(result.mapped, &value, sizeof(T));
+            return result;
+        }
+
+        VkBuffer vk() const { return buffer; }
+        VkDeviceSize region_offset(uint32_t region) const { return region * region_size; }
+        VkDeviceSize region_capacity() const { return region_size; }
+        VkDeviceSize alignment() const { return offset_alignment; }
+        // Most bytes any region has needed since creation
+        VkDeviceSize high_water() const { return peak_usage; }
+    private:
+        VkDevice vk_device = VK_NULL_HANDLE;
+        memory_allocator * allocator = nullptr;
+        VkBuffer buffer = VK_NULL_HANDLE;
+        allocation memory;
+        VkDeviceSize region_size = 0;
+        VkDeviceSize offset_alignment = 1;
+        uint32_t current_region = 0;
+        VkDeviceSize head = 0;
+        VkDeviceSize peak_usage = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,105 @@
+#include "staging_pool.h"
+#include "host_allocator.h"
+#include "physical_device.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace lvk
+{
+    // Keeps every region a multiple of the texel sizes image copies use and of 4 for buffer copies
+    static constexpr VkDeviceSize MIN_STAGING_ALIGNMENT = 16;
+
+    staging_pool::staging_pool(VkDevice device, const physical_device & physical_device, memory_allocator & allocator,
+                               VkDeviceSize buffer_size, uint32_t max_buffers)
+        : vk_device(device), allocator(&allocator), size(buffer_size), max_buffers(max_buffers)
+    {
+        offset_alignment = std::max(MIN_STAGING_ALIGNMENT, physical_device.get_properties().limits.optimalBufferCopyOffsetAlignment);
+    }
+    void staging_pool::destroy()
+    {
+        for (auto & b : buffers)
+        {
+            vkDestroyBuffer(vk_device, b.buffer, host_callbacks());
+            allocator->free(b.memory);
+        }
+        buffers.clear();
+        free_buffers.clear();
+        open_buffers.clear();
+        pending.clear();
+    }
+    bool staging_pool::acquire(VkDeviceSize region_size, staging_region & region)
+    {
+        if (region_size > size)
+            throw std::runtime_error("Staging region is larger than a staging buffer");
+
+        uint32_t index;
+        if (!open_buffers.empty() && buffers[open_buffers.back()].used + region_size <= size)
+            index = open_buffers.back();
+        else if (!free_buffers.empty())
+        {
+            index = free_buffers.back();
+            free_buffers.pop_back();
+            open_buffers.push_back(index);
+        }
+        else if (buffers.size() < max_buffers)
+        {
+            staging_buffer b;
+            VkBufferCreateInfo info = {};
+            info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            info.size = size;
+            info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+            info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            if (vkCreateBuffer(vk_device, &info, host_callbacks(), &b.buffer) != VK_SUCCESS)
+                throw std::runtime_error("Failed to create staging buffer");
+            b.memory = allocator->allocate_buffer(b.buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+            index = (uint32_t)buffers.size();
+            buffers.push_back(b);
+            open_buffers.push_back(index);
+        }
+        else
+        {
+            stalls++;
+            return false;
+        }
+
+        staging_buffer & b = buffers[index];
+        region.buffer = b.buffer;
+        region.offset = b.used;
+        region.mapped = (char *)b.memory.mapped + b.used;
+        b.used = std::min(size, (b.used + region_size + offset_alignment - 1) / offset_alignment * offset_alignment);
+        return true;
+    }
+    void staging_pool::retire(uint64_t value)
+    {
+        for (uint32_t index : open_buffers)
+        {
+            buffers[index].retire_value = value;
+            pending.push_back(index);
+        }
+        open_buffers.clear();
+    }
+    void staging_pool::recycle(uint64_t completed_value)
+    {
+        // Values are retired in submission order, so the queue stays sorted
+        while (!pending.empty() && buffers[pending.front()].retire_value <= completed_value)
+        {
+            buffers[pending.front()].used = 0;
+            free_buffers.push_back(pending.front());
+            pending.pop_front();
+            recycled++;
+        }
+    }
+    staging_pool_stats staging_pool::stats() const
+    {
+        staging_pool_stats result;
+        result.buffers = (uint32_t)buffers.size();
+        result.in_flight = (uint32_t)(pending.size() + open_buffers.size());
+        result.bytes = size * buffers.size();
+        result.recycled = recycled;
+        result.stalls = stalls;
+        return result;
+    }
+}
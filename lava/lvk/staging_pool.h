@@ -0,0 +1,75 @@
+#ifndef LVK_STAGING_POOL_H
+#define LVK_STAGING_POOL_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <deque>
+
+#include "memory_allocator.h"
+
+namespace lvk
+{
+    class physical_device;
+
+    struct staging_region
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        void * mapped = nullptr;    // Already offset to the region
+    };
+
+    struct staging_pool_stats
+    {
+        uint32_t buffers = 0;
+        uint32_t in_flight = 0;
+        VkDeviceSize bytes = 0;
+        uint64_t recycled = 0;
+        uint64_t stalls = 0;        // acquire() calls that found every buffer in flight
+    };
+
+    // Persistently mapped host visible buffers that uploads copy from. Regions are bumped out
+    // of the buffer opened last; retire() tags every buffer used since the previous call with
+    // the timeline value of the submission reading them, and recycle() takes back the ones
+    // whose value has been reached. At most max_buffers exist, so staging memory stays
+    // bounded: once all of them are in flight acquire() fails and the caller has to wait for
+    // oldest_pending(). Uploads larger than buffer_size() have to be split by the caller.
+    class staging_pool
+    {
+    public:
+        staging_pool() = default;
+        staging_pool(VkDevice device, const physical_device & physical_device, memory_allocator & allocator,
+                     VkDeviceSize buffer_size = 8 * 1024 * 1024, uint32_t max_buffers = 4);
+        void destroy();
+
+        bool acquire(VkDeviceSize size, staging_region & region);
+        void retire(uint64_t value);
+        void recycle(uint64_t completed_value);
+
+        // 0 when nothing is waiting to be recycled
+        uint64_t oldest_pending() const { return pending.empty() ? 0 : buffers[pending.front()].retire_value; }
+        VkDeviceSize buffer_size() const { return size; }
+        staging_pool_stats stats() const;
+    private:
+        struct staging_buffer
+        {
+            VkBuffer buffer = VK_NULL_HANDLE;
+            allocation memory;
+            VkDeviceSize used = 0;
+            uint64_t retire_value = 0;
+        };
+
+        VkDevice vk_device = VK_NULL_HANDLE;
+        memory_allocator * allocator = nullptr;
+        VkDeviceSize size = 0;
+        VkDeviceSize offset_alignment = 1;
+        uint32_t max_buffers = 0;
+        std::vector<staging_buffer> buffers;
+        std::vector<uint32_t> free_buffers;
+        std::vector<uint32_t> open_buffers;     // Used since the last retire(), the back one takes new regions
+        std::deque<uint32_t> pending;           // Retired, oldest first
+        uint64_t recycled = 0;
+        uint64_t stalls = 0;
+    };
+}
+
+#endif
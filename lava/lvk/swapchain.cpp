@@ -1,4 +1,5 @@
 #include "swapchain.h"
+#include "host_allocator.h"
 
 #include "device.h"
 #include "physical_device.h"
@@ -41,11 +42,21 @@ namespace lvk
         present_family = index;
         return *this;
     }
+    swapchain_builder & swapchain_builder::present_policy(lvk::present_policy present_policy)
+    {
+        policy = present_policy;
+        return *this;
+    }
+    swapchain_builder & swapchain_builder::old_swapchain(VkSwapchainKHR swapchain)
+    {
+        swapchain_info.oldSwapchain = swapchain;
+        return *this;
+    }
     swapchain swapchain_builder::build()
     {
         VkSurfaceFormatKHR swapchain_format = phys_dev.choose_swapchain_surface_format();
-        VkPresentModeKHR swapchain_present_mode = phys_dev.choose_swapchain_present_mode();
-        uint32_t swapchain_length = phys_dev.choose_swapchain_length();
+        VkPresentModeKHR swapchain_present_mode = phys_dev.choose_swapchain_present_mode(policy);
+        uint32_t swapchain_length = phys_dev.choose_swapchain_length(policy);
 
         surface_details surface_details = phys_dev.query_surface_details();
 
@@ -59,8 +70,9 @@ namespace lvk
         {
             swapchain_info.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
             swapchain_info.queueFamilyIndexCount = 2;
-            uint32_t indices[] = { graphics_family, present_family };
-            swapchain_info.pQueueFamilyIndices = indices;
+            queue_family_indices[0] = graphics_family;
+            queue_family_indices[1] = present_family;
+            swapchain_info.pQueueFamilyIndices = queue_family_indices;
         }
         else
         {
@@ -71,15 +83,14 @@ namespace lvk
 
         swapchain_info.preTransform = surface_details.capabilities.currentTransform;
         swapchain_info.presentMode = swapchain_present_mode;
-        swapchain_info.oldSwapchain = VK_NULL_HANDLE;
 
-        return swapchain(swapchain_info, dev.vk());
+        return swapchain(swapchain_info, dev.vk(), policy, phys_dev.choose_frames_in_flight(policy));
     }
 
-    swapchain::swapchain(VkSwapchainCreateInfoKHR create_info, VkDevice device)
-        : vk_device(device), info(create_info)
+    swapchain::swapchain(VkSwapchainCreateInfoKHR create_info, VkDevice device, present_policy policy, uint32_t frames_in_flight)
+        : vk_device(device), info(create_info), swapchain_policy(policy), frames_in_flight(frames_in_flight)
     {
-        VkResult result = vkCreateSwapchainKHR(vk_device, &create_info, nullptr, &vk_object);
+        VkResult result = vkCreateSwapchainKHR(vk_device, &create_info, host_callbacks(), &vk_object);
         if (result != VK_SUCCESS)
             throw std::runtime_error("Failed to create swapchain");
 
@@ -104,6 +115,6 @@ namespace lvk
     {
         for (int i = 0; i < image_views.size(); i++)
             image_views[i].destroy();
-        vkDestroySwapchainKHR(vk_device, vk_object, nullptr);
+        vkDestroySwapchainKHR(vk_device, vk_object, host_callbacks());
     }
 }
\ No newline at end of file
@@ -6,23 +6,26 @@
 #include <vector>
 
 #include "object.h"
+#include "physical_device.h"
 
 namespace lvk
 {
     class device;
-    class physical_device;
 
     class swapchain : public object<VkSwapchainKHR>
     {
     public:
         swapchain() = default;
-        swapchain(VkSwapchainCreateInfoKHR create_info, VkDevice device);
+        swapchain(VkSwapchainCreateInfoKHR create_info, VkDevice device, present_policy policy = present_policy::low_latency, uint32_t frames_in_flight = 2);
         void destroy();
         ~swapchain(){}
 
         uint32_t size() const { return (uint32_t)images.size(); }
         VkFormat image_format() const { return info.imageFormat; }
         VkExtent2D image_extent() const { return info.imageExtent; }
+        VkPresentModeKHR present_mode() const { return info.presentMode; }
+        lvk::present_policy policy() const { return swapchain_policy; }
+        uint32_t recommended_frames_in_flight() const { return frames_in_flight; }
 
         const std::vector<image_view> & get_image_views() { return image_views; }
     private:
@@ -30,6 +33,8 @@ namespace lvk
         VkSwapchainCreateInfoKHR info;
         std::vector<VkImage> images;
         std::vector<image_view> image_views;
+        lvk::present_policy swapchain_policy = present_policy::low_latency;
+        uint32_t frames_in_flight = 2;
     };
 
     class swapchain_builder
@@ -43,12 +48,16 @@ namespace lvk
         swapchain_builder & clipped(VkBool32 clipped);
         swapchain_builder & graphics_family_index(uint32_t index);
         swapchain_builder & present_family_index(uint32_t index);
+        swapchain_builder & present_policy(lvk::present_policy policy);
+        swapchain_builder & old_swapchain(VkSwapchainKHR swapchain);
 
         swapchain build();
     private:
         VkSwapchainCreateInfoKHR swapchain_info;
         uint32_t graphics_family;
         uint32_t present_family;
+        uint32_t queue_family_indices[2];
+        lvk::present_policy policy = lvk::present_policy::low_latency;
         const device & dev;
         const physical_device & phys_dev;
     };
@@ -0,0 +1,77 @@
+#include "task_graph.h"
+
+#include <stdexcept>
+
+namespace lvk
+{
+    static double milliseconds(std::chrono::steady_clock::duration duration)
+    {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    uint32_t task_graph::add(const std::string & name, task_function work, std::initializer_list<uint32_t> dependencies)
+    {
+        uint32_t index = (uint32_t)tasks.size();
+        for (uint32_t dependency : dependencies)
+        {
+            if (dependency >= index)
+                throw std::runtime_error("Task '" + name + "' depends on a task that wasn't added before it");
+            tasks[dependency]->dependents.push_back(index);
+        }
+
+        tasks.emplace_back(new task());
+        tasks.back()->timing.name = name;
+        tasks.back()->work = std::move(work);
+        tasks.back()->dependency_count = (uint32_t)dependencies.size();
+        return index;
+    }
+    void task_graph::run(job_system & jobs)
+    {
+        started = std::chrono::steady_clock::now();
+
+        // Roots are only queued once every count is set, a quick root could otherwise release a dependent early
+        for (auto & task : tasks)
+            task->remaining.store(task->dependency_count);
+
+        job_counter counter;
+        for (uint32_t i = 0; i < tasks.size(); i++)
+            if (tasks[i]->dependency_count == 0)
+                start(jobs, i, counter);
+
+        // Measured before rethrowing, so a failed startup still reports how far it got
+        try
+        {
+            jobs.wait(counter);
+        }
+        catch (...)
+        {
+            elapsed = milliseconds(std::chrono::steady_clock::now() - started);
+            throw;
+        }
+        elapsed = milliseconds(std::chrono::steady_clock::now() - started);
+    }
+    std::vector<task_timing> task_graph::timings() const
+    {
+        std::vector<task_timing> result;
+        for (const auto & task : tasks)
+            result.push_back(task->timing);
+        return result;
+    }
+    void task_graph::start(job_system & jobs, uint32_t index, job_counter & counter)
+    {
+        // Dependents are queued against the counter before this job finishes, so it can't drop to zero in between
+        jobs.run([this, &jobs, &counter, index]()
+        {
+            task & current = *tasks[index];
+            auto begin = std::chrono::steady_clock::now();
+            current.work();
+            auto end = std::chrono::steady_clock::now();
+            current.timing.start_ms = milliseconds(begin - started);
+            current.timing.duration_ms = milliseconds(end - begin);
+
+            for (uint32_t dependent : current.dependents)
+                if (--tasks[dependent]->remaining == 0)
+                    start(jobs, dependent, counter);
+        }, &counter);
+    }
+}
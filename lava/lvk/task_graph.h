@@ -0,0 +1,56 @@
+#ifndef LVK_TASK_GRAPH_H
+#define LVK_TASK_GRAPH_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <initializer_list>
+
+#include "job_system.h"
+
+namespace lvk
+{
+    struct task_timing
+    {
+        std::string name;
+        double start_ms = 0.0;      // Since run() was called
+        double duration_ms = 0.0;
+    };
+
+    // Named tasks run on a job_system as soon as everything they depend on has finished,
+    // each one timed. Dependencies are given as ids returned by earlier add() calls, so the
+    // graph can't have cycles. A task that waits on other jobs may run further tasks in the
+    // meantime, and their time counts towards its own duration.
+    class task_graph
+    {
+    public:
+        using task_function = std::function<void()>;
+
+        uint32_t add(const std::string & name, task_function work, std::initializer_list<uint32_t> dependencies = {});
+        // Blocks until every task ran and rethrows the first exception; tasks depending on a failed one never start
+        void run(job_system & jobs);
+
+        std::vector<task_timing> timings() const;
+        double elapsed_ms() const { return elapsed; }
+    private:
+        struct task
+        {
+            task_timing timing;
+            task_function work;
+            std::vector<uint32_t> dependents;
+            uint32_t dependency_count = 0;
+            std::atomic<uint32_t> remaining{ 0 };
+        };
+
+        void start(job_system & jobs, uint32_t index, job_counter & counter);
+
+        std::vector<std::unique_ptr<task>> tasks;
+        std::chrono::steady_clock::time_point started;
+        double elapsed = 0.0;
+    };
+}
+
+#endif
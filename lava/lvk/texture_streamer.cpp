@@ -0,0 +1,311 @@
+#include "texture_streamer.h"
+#include "host_allocator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace lvk
+{
+    // Levels this small cost next to nothing, so they become resident together right after decoding
+    static constexpr uint32_t RESIDENT_TAIL_SIZE = 64;
+    static constexpr uint8_t PLACEHOLDER_TEXEL[4] = { 128, 128, 128, 255 };
+
+    static uint32_t level_extent(uint32_t extent, uint32_t level)
+    {
+        return std::max(extent >> level, 1u);
+    }
+    static float srgb_to_linear(uint8_t value)
+    {
+        float c = value / 255.0f;
+        return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+    static uint8_t linear_to_srgb(float value)
+    {
+        float c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+        return (uint8_t)std::min(255.0f, std::max(0.0f, c * 255.0f + 0.5f));
+    }
+    // 2x2 box filter down to 1x1, averaging colour in linear space for sRGB formats
+    static void build_mip_chain(std::vector<std::vector<uint8_t>> & levels, uint32_t width, uint32_t height, bool srgb)
+    {
+        float to_linear[256];
+        for (uint32_t i = 0; i < 256; i++)
+            to_linear[i] = srgb ? srgb_to_linear((uint8_t)i) : i / 255.0f;
+
+        for (uint32_t level = 1; level_extent(width, level - 1) > 1 || level_extent(height, level - 1) > 1; level++)
+        {
+            uint32_t src_width = level_extent(width, level - 1);
+            uint32_t src_height = level_extent(height, level - 1);
+            uint32_t dst_width = level_extent(width, level);
+            uint32_t dst_height = level_extent(height, level);
+            const std::vector<uint8_t> & src = levels[level - 1];
+            std::vector<uint8_t> dst(dst_width * dst_height * 4);
+
+            for (uint32_t y = 0; y < dst_height; y++)
+                for (uint32_t x = 0; x < dst_width; x++)
+                {
+                    uint32_t x0 = std::min(x * 2, src_width - 1), x1 = std::min(x * 2 + 1, src_width - 1);
+                    uint32_t y0 = std::min(y * 2, src_height - 1), y1 = std::min(y * 2 + 1, src_height - 1);
+                    const uint8_t * texels[4] = { &src[(y0 * src_width + x0) * 4], &src[(y0 * src_width + x1) * 4],
+                                                  &src[(y1 * src_width + x0) * 4], &src[(y1 * src_width + x1) * 4] };
+                    uint8_t * out = &dst[(y * dst_width + x) * 4];
+                    for (uint32_t c = 0; c < 3; c++)
+                    {
+                        float sum = to_linear[texels[0][c]] + to_linear[texels[1][c]] + to_linear[texels[2][c]] + to_linear[texels[3][c]];
+                        out[c] = srgb ? linear_to_srgb(sum * 0.25f) : (uint8_t)(sum * 0.25f * 255.0f + 0.5f);
+                    }
+                    out[3] = (uint8_t)((texels[0][3] + texels[1][3] + texels[2][3] + texels[3][3] + 2) / 4);
+                }
+            levels.push_back(std::move(dst));
+        }
+    }
+
+    texture_streamer::texture_streamer(VkDevice device, memory_allocator & allocator, upload_engine & uploads, VkFormat format, uint32_t decode_threads,
+                                       VkDeviceSize bytes_per_update)
+        : vk_device(device), allocator(&allocator), uploads(&uploads), format(format), bytes_per_update(bytes_per_update)
+    {
+        // The calling thread counts as one of the system's workers but never waits on it, so every decode runs on the others
+        decoder.reset(new job_system(std::max(decode_threads, 1u) + 1));
+
+        VkImageCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        info.imageType = VK_IMAGE_TYPE_2D;
+        info.format = format;
+        info.extent = { 1, 1, 1 };
+        info.mipLevels = 1;
+        info.arrayLayers = 1;
+        info.samples = VK_SAMPLE_COUNT_1_BIT;
+        info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        info.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if (vkCreateImage(vk_device, &info, host_callbacks(), &placeholder) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create placeholder texture");
+        placeholder_memory = allocator.allocate_image(placeholder, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        uploads.upload_image(placeholder, PLACEHOLDER_TEXEL, sizeof(PLACEHOLDER_TEXEL), 1, 1, 1, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+        placeholder_view = create_view(placeholder, 0, 1);
+    }
+    void texture_streamer::destroy()
+    {
+        if (budget)
+            budget->unsubscribe(budget_subscription);
+        budget = nullptr;
+
+        // Decodes still running write into their textures, and a failed one has nobody left to report to
+        for (auto & texture : textures)
+        {
+            try
+            {
+                decoder->wait(texture->decoded);
+            }
+            catch (...)
+            {
+            }
+            for (const auto & view : texture->views)
+                vkDestroyImageView(vk_device, view.second, host_callbacks());
+            if (texture->image != VK_NULL_HANDLE)
+            {
+                vkDestroyImage(vk_device, texture->image, host_callbacks());
+                allocator->free(texture->memory);
+            }
+        }
+        textures.clear();
+        decoder.reset();
+
+        vkDestroyImageView(vk_device, placeholder_view, host_callbacks());
+        vkDestroyImage(vk_device, placeholder, host_callbacks());
+        allocator->free(placeholder_memory);
+    }
+    uint32_t texture_streamer::stream(const decode_function & decode)
+    {
+        textures.emplace_back(new streamed_texture());
+        streamed_texture * texture = textures.back().get();
+        bool srgb = format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_B8G8R8A8_SRGB;
+
+        decoder->run([texture, decode, srgb]()
+        {
+            texture_pixels pixels = decode();
+            texture->width = pixels.width;
+            texture->height = pixels.height;
+            texture->levels.push_back(std::move(pixels.rgba));
+            build_mip_chain(texture->levels, texture->width, texture->height, srgb);
+        }, &texture->decoded);
+        return (uint32_t)textures.size() - 1;
+    }
+    void texture_streamer::update()
+    {
+        // Tickets complete in order and levels are queued smallest first, so each landed one replaces the last
+        for (auto & t : textures)
+        {
+            streamed_texture & texture = *t;
+            uint32_t landed = texture.resident_level;
+            while (!texture.in_flight.empty() && uploads->ready(texture.in_flight.front().second))
+            {
+                landed = texture.in_flight.front().first;
+                texture.in_flight.pop_front();
+            }
+            if (landed != texture.resident_level)
+            {
+                texture.resident_level = landed;
+                texture.version++;
+                texture.views.emplace_back(texture.version, create_view(texture.image, landed, texture.mip_levels - landed));
+            }
+        }
+
+        VkDeviceSize spent = 0;
+        for (uint32_t i = 0; i < textures.size(); i++)
+        {
+            streamed_texture & texture = *textures[i];
+            if (!texture.error.empty())
+                continue;
+            if (texture.image == VK_NULL_HANDLE)
+            {
+                if (!texture.decoded.done())
+                    continue;
+                // Returns at once and rethrows a failed decode, which keeps the placeholder and is left to error()
+                try
+                {
+                    decoder->wait(texture.decoded);
+                }
+                catch (const std::exception & e)
+                {
+                    texture.error = e.what()[0] != '\0' ? e.what() : "unknown error";
+                }
+                catch (...)
+                {
+                    texture.error = "unknown error";
+                }
+                if (!texture.error.empty())
+                {
+                    std::vector<std::vector<uint8_t>>().swap(texture.levels);
+                    continue;
+                }
+                create_image(texture);
+            }
+
+            while (texture.next_level > 0)
+            {
+                uint32_t level = texture.next_level - 1;
+                uint32_t width = level_extent(texture.width, level);
+                uint32_t height = level_extent(texture.height, level);
+                bool tail = std::max(width, height) <= RESIDENT_TAIL_SIZE;
+                // Past the tail, level 0 goes up alone and the levels between it and the tail are generated from it
+                bool generate = !tail && uploads->generates_mipmaps();
+                VkDeviceSize bytes = texture.levels[generate ? 0 : level].size();
+                if (!tail && under_pressure())
+                    break;
+                if (!tail && spent != 0 && spent + bytes > bytes_per_update)
+                    return;
+
+                if (generate)
+                {
+                    upload_ticket ticket = uploads->upload_image_with_mipmaps(texture.image, texture.levels[0].data(), bytes, texture.image_info, level + 1,
+                                                                              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                                                              VK_ACCESS_SHADER_READ_BIT);
+                    texture.in_flight.emplace_back(0, ticket);
+                    for (uint32_t l = 0; l <= level; l++)
+                        std::vector<uint8_t>().swap(texture.levels[l]);
+                    texture.next_level = 0;
+                    spent += bytes;
+                    break;
+                }
+
+                upload_ticket ticket = uploads->upload_image_level(texture.image, texture.levels[level].data(), bytes, width, height, level,
+                                                                   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                                                   VK_ACCESS_SHADER_READ_BIT);
+                texture.in_flight.emplace_back(level, ticket);
+                std::vector<uint8_t>().swap(texture.levels[level]);
+                texture.next_level = level;
+                spent += bytes;
+            }
+        }
+    }
+    void texture_streamer::watch_budget(memory_budget & watched, float threshold)
+    {
+        budget = &watched;
+        budget_subscription = watched.subscribe(threshold, [this](const heap_budget & heap, float, bool rising)
+        {
+            if (!(heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT))
+                return;
+            if (rising)
+                pressured_heaps++;
+            else if (pressured_heaps > 0)
+                pressured_heaps--;
+        });
+    }
+    VkImageView texture_streamer::view(uint32_t texture) const
+    {
+        const streamed_texture & t = *textures[texture];
+        return t.views.empty() ? placeholder_view : t.views.back().second;
+    }
+    void texture_streamer::retire_views(uint32_t texture, uint64_t version, deferred_queue & queue, uint64_t value)
+    {
+        // The current view is never retired, whatever version is passed
+        streamed_texture & t = *textures[texture];
+        VkDevice device = vk_device;
+        while (t.views.size() > 1 && t.views.front().first < version)
+        {
+            VkImageView old_view = t.views.front().second;
+            queue.defer(value, [device, old_view]() { vkDestroyImageView(device, old_view, host_callbacks()); });
+            t.views.pop_front();
+        }
+    }
+    void texture_streamer::create_image(streamed_texture & texture)
+    {
+        // A quarter of the memory for a blurrier texture, which stays that way once the pressure is gone
+        if (under_pressure() && texture.levels.size() > 1)
+        {
+            texture.levels.erase(texture.levels.begin());
+            texture.width = level_extent(texture.width, 1);
+            texture.height = level_extent(texture.height, 1);
+        }
+
+        texture.mip_levels = (uint32_t)texture.levels.size();
+        texture.next_level = texture.mip_levels;
+        texture.resident_level = texture.mip_levels;
+
+        VkImageCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        info.imageType = VK_IMAGE_TYPE_2D;
+        info.format = format;
+        info.extent = { texture.width, texture.height, 1 };
+        info.mipLevels = texture.mip_levels;
+        info.arrayLayers = 1;
+        info.samples = VK_SAMPLE_COUNT_1_BIT;
+        info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        info.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        // Either generation path may be picked, compute through storage views or blits
+        if (uploads->generates_mipmaps())
+        {
+            info.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT | mip_generator::compute_usage();
+            info.flags |= mip_generator::compute_flags(format);
+        }
+
+        if (vkCreateImage(vk_device, &info, host_callbacks(), &texture.image) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create streamed texture");
+        texture.image_info = info;
+        texture.memory = allocator->allocate_image(texture.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+    VkImageView texture_streamer::create_view(VkImage image, uint32_t base_level, uint32_t level_count)
+    {
+        VkImageViewCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        info.image = image;
+        info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        info.format = format;
+        info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        info.subresourceRange.baseMipLevel = base_level;
+        info.subresourceRange.levelCount = level_count;
+        info.subresourceRange.baseArrayLayer = 0;
+        info.subresourceRange.layerCount = 1;
+
+        VkImageView view;
+        if (vkCreateImageView(vk_device, &info, host_callbacks(), &view) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create streamed texture view");
+        return view;
+    }
+}
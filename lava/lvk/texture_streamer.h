@@ -0,0 +1,107 @@
+#ifndef LVK_TEXTURE_STREAMER_H
+#define LVK_TEXTURE_STREAMER_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <string>
+#include <functional>
+
+#include "memory_allocator.h"
+#include "memory_budget.h"
+#include "upload_engine.h"
+#include "timeline.h"
+#include "job_system.h"
+
+namespace lvk
+{
+    struct texture_pixels
+    {
+        std::vector<uint8_t> rgba;
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
+    // Streams RGBA8 textures in the background. stream() returns at once with a shared 1x1
+    // placeholder standing in; the texture is decoded and its mip chain built on the
+    // streamer's own decode threads, which the main thread never helps out with, then
+    // update() uploads the levels smallest first. The levels up to RESIDENT_TAIL_SIZE
+    // pixels go in one step, larger ones within a byte budget per update. When the upload
+    // engine generates mipmaps, only level 0 goes up after the tail and the GPU fills the
+    // levels in between: their uploads are saved, at the cost of their refinement steps.
+    // Every time a level lands the texture gets a view starting at it and its version is
+    // bumped, which tells users to rewrite their descriptors. Users hand older views back
+    // through retire_views() once none of their descriptor sets point at them anymore.
+    // While a watched budget has a device local heap over its threshold, levels above the
+    // resident tail wait, and textures leave out their largest level.
+    class texture_streamer
+    {
+    public:
+        // Runs on a worker thread and throws on failure, which leaves the placeholder standing in for good
+        using decode_function = std::function<texture_pixels()>;
+
+        texture_streamer() = default;
+        texture_streamer(VkDevice device, memory_allocator & allocator, upload_engine & uploads, VkFormat format, uint32_t decode_threads = 1,
+                         VkDeviceSize bytes_per_update = 4 * 1024 * 1024);
+        void destroy();
+
+        uint32_t stream(const decode_function & decode);
+        void update();
+        // Must be called once the streamer is in its final place, the subscription refers to it
+        void watch_budget(memory_budget & budget, float threshold = 1.0f);
+        bool under_pressure() const { return pressured_heaps > 0; }
+
+        VkImageView view(uint32_t texture) const;
+        uint64_t version(uint32_t texture) const { return textures[texture]->version; }
+        // Views older than version's are destroyed once value has been collected from the queue
+        void retire_views(uint32_t texture, uint64_t version, deferred_queue & queue, uint64_t value);
+        // The largest mip that has landed, 0 once fully resident; mip_levels() while the placeholder stands in
+        uint32_t resident_level(uint32_t texture) const { return textures[texture]->resident_level; }
+        uint32_t mip_levels(uint32_t texture) const { return textures[texture]->mip_levels; }
+        bool fully_resident(uint32_t texture) const { return textures[texture]->image != VK_NULL_HANDLE && textures[texture]->resident_level == 0; }
+        // Why the decode failed, empty while it hasn't
+        const std::string & error(uint32_t texture) const { return textures[texture]->error; }
+    private:
+        struct streamed_texture
+        {
+            job_counter decoded;
+            // Written by the decode job, read once decoded is done. Levels are dropped as they are uploaded.
+            std::vector<std::vector<uint8_t>> levels;
+            uint32_t width = 0;
+            uint32_t height = 0;
+            std::string error;
+
+            VkImage image = VK_NULL_HANDLE;
+            VkImageCreateInfo image_info = {};
+            allocation memory;
+            uint32_t mip_levels = 0;
+            uint32_t next_level = 0;        // Levels from here up are uploaded or in flight
+            uint32_t resident_level = 0;
+            std::deque<std::pair<uint32_t, upload_ticket>> in_flight;
+            std::deque<std::pair<uint64_t, VkImageView>> views;    // With the version each became current at
+            uint64_t version = 0;
+        };
+
+        void create_image(streamed_texture & texture);
+        VkImageView create_view(VkImage image, uint32_t base_level, uint32_t level_count);
+
+        VkDevice vk_device = VK_NULL_HANDLE;
+        memory_allocator * allocator = nullptr;
+        upload_engine * uploads = nullptr;
+        // A private system, so waiting on the renderer's jobs never picks up a decode
+        std::unique_ptr<job_system> decoder;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        VkDeviceSize bytes_per_update = 0;
+        memory_budget * budget = nullptr;
+        uint32_t budget_subscription = 0;
+        uint32_t pressured_heaps = 0;
+
+        VkImage placeholder = VK_NULL_HANDLE;
+        allocation placeholder_memory;
+        VkImageView placeholder_view = VK_NULL_HANDLE;
+        std::vector<std::unique_ptr<streamed_texture>> textures;
+    };
+}
+
+#endif
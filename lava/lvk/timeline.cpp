@@ -0,0 +1,132 @@
+#include "timeline.h"
+#include "host_allocator.h"
+#include <stdexcept>
+
+namespace lvk
+{
+    timeline::timeline(VkDevice device, uint64_t initial_value)
+        : vk_device(device), pending_value(initial_value)
+    {
+        VkSemaphoreTypeCreateInfo type_info = {};
+        type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        type_info.initialValue = initial_value;
+
+        VkSemaphoreCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        info.pNext = &type_info;
+
+        if (vkCreateSemaphore(vk_device, &info, host_callbacks(), &vk_object) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create timeline semaphore");
+    }
+    void timeline::destroy()
+    {
+        vkDestroySemaphore(vk_device, vk_object, host_callbacks());
+        vk_object = VK_NULL_HANDLE;
+    }
+    uint64_t timeline::completed() const
+    {
+        uint64_t value = 0;
+        vkGetSemaphoreCounterValue(vk_device, vk_object, &value);
+        return value;
+    }
+    bool timeline::wait(uint64_t value, uint64_t timeout) const
+    {
+        VkSemaphoreWaitInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        info.semaphoreCount = 1;
+        info.pSemaphores = &vk_object;
+        info.pValues = &value;
+
+        VkResult result = vkWaitSemaphores(vk_device, &info, timeout);
+        if (result != VK_SUCCESS && result != VK_TIMEOUT)
+            throw std::runtime_error("Failed to wait on timeline semaphore");
+        return result == VK_SUCCESS;
+    }
+    void timeline::signal(uint64_t value)
+    {
+        VkSemaphoreSignalInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
+        info.semaphore = vk_object;
+        info.value = value;
+
+        if (vkSignalSemaphore(vk_device, &info) != VK_SUCCESS)
+            throw std::runtime_error("Failed to signal timeline semaphore");
+        if (value > pending_value)
+            pending_value = value;
+    }
+
+    timeline_submit & timeline_submit::wait(VkSemaphore semaphore, VkPipelineStageFlags stage, uint64_t value)
+    {
+        wait_semaphores.push_back(semaphore);
+        wait_stages.push_back(stage);
+        wait_values.push_back(value);
+        return *this;
+    }
+    timeline_submit & timeline_submit::wait(const timeline & timeline, uint64_t value, VkPipelineStageFlags stage)
+    {
+        return wait(timeline.vk(), stage, value);
+    }
+    timeline_submit & timeline_submit::signal(VkSemaphore semaphore, uint64_t value)
+    {
+        signal_semaphores.push_back(semaphore);
+        signal_values.push_back(value);
+        return *this;
+    }
+    timeline_submit & timeline_submit::signal(const timeline & timeline, uint64_t value)
+    {
+        return signal(timeline.vk(), value);
+    }
+    timeline_submit & timeline_submit::command_buffer(VkCommandBuffer command_buffer)
+    {
+        buffers.push_back(command_buffer);
+        return *this;
+    }
+    timeline_submit & timeline_submit::command_buffers(const std::vector<VkCommandBuffer> & command_buffers)
+    {
+        buffers.insert(buffers.end(), command_buffers.begin(), command_buffers.end());
+        return *this;
+    }
+    VkResult timeline_submit::submit(VkQueue queue, VkFence fence)
+    {
+        VkTimelineSemaphoreSubmitInfo timeline_info = {};
+        timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timeline_info.waitSemaphoreValueCount = (uint32_t)wait_values.size();
+        timeline_info.pWaitSemaphoreValues = wait_values.data();
+        timeline_info.signalSemaphoreValueCount = (uint32_t)signal_values.size();
+        timeline_info.pSignalSemaphoreValues = signal_values.data();
+
+        VkSubmitInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        info.pNext = &timeline_info;
+        info.waitSemaphoreCount = (uint32_t)wait_semaphores.size();
+        info.pWaitSemaphores = wait_semaphores.data();
+        info.pWaitDstStageMask = wait_stages.data();
+        info.signalSemaphoreCount = (uint32_t)signal_semaphores.size();
+        info.pSignalSemaphores = signal_semaphores.data();
+        info.commandBufferCount = (uint32_t)buffers.size();
+        info.pCommandBuffers = buffers.data();
+
+        return vkQueueSubmit(queue, 1, &info, fence);
+    }
+
+    void deferred_queue::defer(uint64_t value, std::function<void()> work)
+    {
+        pending.emplace_back(value, std::move(work));
+    }
+    void deferred_queue::collect(uint64_t completed_value)
+    {
+        // Values are handed out in submission order, so the queue stays sorted
+        while (!pending.empty() && pending.front().first <= completed_value)
+        {
+            pending.front().second();
+            pending.pop_front();
+        }
+    }
+    void deferred_queue::flush()
+    {
+        for (auto & item : pending)
+            item.second();
+        pending.clear();
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef LVK_TIMELINE_H
+#define LVK_TIMELINE_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <deque>
+#include <functional>
+
+#include "object.h"
+
+namespace lvk
+{
+    // Monotonic GPU/CPU clock backed by a core 1.2 timeline semaphore. Every submission
+    // signals a fresh value from next(), and anything waiting on that work waits for the
+    // value instead of a fence. Use one timeline per submitting queue; other queues wait
+    // on its values to synchronise with it.
+    class timeline : public object<VkSemaphore>
+    {
+    public:
+        timeline() = default;
+        timeline(VkDevice device, uint64_t initial_value = 0);
+        void destroy();
+
+        uint64_t next() { return ++pending_value; }
+        uint64_t last_submitted() const { return pending_value; }
+        uint64_t completed() const;
+        bool reached(uint64_t value) const { return completed() >= value; }
+        bool wait(uint64_t value, uint64_t timeout = UINT64_MAX) const;
+        void signal(uint64_t value);
+    private:
+        VkDevice vk_device = VK_NULL_HANDLE;
+        uint64_t pending_value = 0;
+    };
+
+    // Collects binary and timeline semaphores for a single vkQueueSubmit. Binary semaphores
+    // are added with a value of 0, which the driver ignores.
+    class timeline_submit
+    {
+    public:
+        timeline_submit & wait(VkSemaphore semaphore, VkPipelineStageFlags stage, uint64_t value = 0);
+        timeline_submit & wait(const timeline & timeline, uint64_t value, VkPipelineStageFlags stage);
+        timeline_submit & signal(VkSemaphore semaphore, uint64_t value = 0);
+        timeline_submit & signal(const timeline & timeline, uint64_t value);
+        timeline_submit & command_buffer(VkCommandBuffer command_buffer);
+        timeline_submit & command_buffers(const std::vector<VkCommandBuffer> & command_buffers);
+
+        VkResult submit(VkQueue queue, VkFence fence = VK_NULL_HANDLE);
+    private:
+        std::vector<VkSemaphore> wait_semaphores;
+        std::vector<VkPipelineStageFlags> wait_stages;
+        std::vector<uint64_t> wait_values;
+        std::vector<VkSemaphore> signal_semaphores;
+        std::vector<uint64_t> signal_values;
+        std::vector<VkCommandBuffer> buffers;
+    };
+
+    // Work (usually resource destruction) that must not run until the GPU has passed a
+    // timeline value.
+    class deferred_queue
+    {
+    public:
+        void defer(uint64_t value, std::function<void()> work);
+        void collect(uint64_t completed_value);
+        void flush();
+
+        size_t size() const { return pending.size(); }
+    private:
+        std::deque<std::pair<uint64_t, std::function<void()>>> pending;
+    };
+}
+
+#endif
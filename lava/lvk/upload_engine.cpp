@@ -0,0 +1,321 @@
+#include "upload_engine.h"
+#include "host_allocator.h"
+#include "physical_device.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace lvk
+{
+    upload_engine::upload_engine(VkDevice device, const physical_device & physical_device, memory_allocator & allocator, queue transfer_queue, queue graphics_queue,
+                                 timeline & graphics_timeline, mip_generator * mips)
+        : vk_device(device), transfer(transfer_queue), graphics(graphics_queue), graphics_timeline(&graphics_timeline), mips(mips)
+    {
+        transfer_timeline = timeline(vk_device);
+        staging = staging_pool(vk_device, physical_device, allocator);
+
+        VkCommandPoolCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+        info.queueFamilyIndex = transfer.family_index;
+        if (vkCreateCommandPool(vk_device, &info, host_callbacks(), &transfer_pool) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create transfer command pool");
+
+        info.queueFamilyIndex = graphics.family_index;
+        if (vkCreateCommandPool(vk_device, &info, host_callbacks(), &graphics_pool) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create acquire command pool");
+    }
+    void upload_engine::destroy()
+    {
+        // Expects the device to be idle, so every deferred release is safe to run now
+        transfer_garbage.flush();
+        graphics_garbage.flush();
+        in_flight.clear();
+        recording = VK_NULL_HANDLE;
+
+        vkDestroyCommandPool(vk_device, transfer_pool, host_callbacks());
+        vkDestroyCommandPool(vk_device, graphics_pool, host_callbacks());
+        staging.destroy();
+        transfer_timeline.destroy();
+    }
+    upload_ticket upload_engine::upload_buffer(VkBuffer buffer, const void * data, VkDeviceSize size, VkDeviceSize offset,
+                                               VkPipelineStageFlags dst_stage, VkAccessFlags dst_access)
+    {
+        for (VkDeviceSize copied = 0; copied < size; copied += staging.buffer_size())
+        {
+            VkDeviceSize chunk = std::min(staging.buffer_size(), size - copied);
+            staging_region staged = stage((const char *)data + copied, chunk);
+
+            VkBufferCopy region = {};
+            region.srcOffset = staged.offset;
+            region.dstOffset = offset + copied;
+            region.size = chunk;
+            vkCmdCopyBuffer(open_batch(), staged.buffer, buffer, 1, &region);
+        }
+        VkCommandBuffer command_buffer = open_batch();
+
+        VkBufferMemoryBarrier release = {};
+        release.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        release.dstAccessMask = 0;
+        release.srcQueueFamilyIndex = ownership_transfer() ? transfer.family_index : VK_QUEUE_FAMILY_IGNORED;
+        release.dstQueueFamilyIndex = ownership_transfer() ? graphics.family_index : VK_QUEUE_FAMILY_IGNORED;
+        release.buffer = buffer;
+        release.offset = offset;
+        release.size = size;
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                             0, nullptr, 1, &release, 0, nullptr);
+
+        if (ownership_transfer())
+        {
+            VkBufferMemoryBarrier acquire = release;
+            acquire.srcAccessMask = 0;
+            acquire.dstAccessMask = dst_access;
+            current.buffer_acquires.push_back(acquire);
+        }
+        current.dst_stages |= dst_stage;
+
+        upload_ticket ticket;
+        ticket.id = ++next_ticket;
+        ticket.transfer_value = transfer_timeline.last_submitted() + 1;
+        current.last_ticket = ticket.id;
+
+        return ticket;
+    }
+    upload_ticket upload_engine::upload_image(VkImage image, const void * data, VkDeviceSize size, uint32_t width, uint32_t height, uint32_t mip_levels,
+                                              VkImageLayout final_layout, VkPipelineStageFlags dst_stage, VkAccessFlags dst_access)
+    {
+        return record_image_upload(image, data, size, width, height, 0, mip_levels, final_layout, dst_stage, dst_access, nullptr);
+    }
+    upload_ticket upload_engine::upload_image_with_mipmaps(VkImage image, const void * data, VkDeviceSize size, const VkImageCreateInfo & info, uint32_t level_count,
+                                                           VkImageLayout final_layout, VkPipelineStageFlags dst_stage, VkAccessFlags dst_access)
+    {
+        if (!mips)
+            throw std::runtime_error("Mipmapped uploads need a mip generator");
+        return record_image_upload(image, data, size, info.extent.width, info.extent.height, 0, level_count, final_layout, dst_stage, dst_access, &info);
+    }
+    upload_ticket upload_engine::upload_image_level(VkImage image, const void * data, VkDeviceSize size, uint32_t width, uint32_t height, uint32_t level,
+                                                    VkImageLayout final_layout, VkPipelineStageFlags dst_stage, VkAccessFlags dst_access)
+    {
+        return record_image_upload(image, data, size, width, height, level, 1, final_layout, dst_stage, dst_access, nullptr);
+    }
+    upload_ticket upload_engine::record_image_upload(VkImage image, const void * data, VkDeviceSize size, uint32_t width, uint32_t height,
+                                                     uint32_t base_level, uint32_t level_count, VkImageLayout final_layout, VkPipelineStageFlags dst_stage,
+                                                     VkAccessFlags dst_access, const VkImageCreateInfo * mip_info)
+    {
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = base_level;
+        barrier.subresourceRange.levelCount = level_count;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(open_batch(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             0, nullptr, 0, nullptr, 1, &barrier);
+
+        // Large images are copied in bands of whole rows; batches run in order, so a band
+        // submitted early still lands after the layout transition
+        VkDeviceSize row_size = size / height;
+        uint32_t rows_per_chunk = (uint32_t)std::min<VkDeviceSize>(height, staging.buffer_size() / row_size);
+        if (rows_per_chunk == 0)
+            throw std::runtime_error("Image row does not fit in a staging buffer");
+        for (uint32_t y = 0; y < height; y += rows_per_chunk)
+        {
+            uint32_t rows = std::min(rows_per_chunk, height - y);
+            staging_region staged = stage((const char *)data + y * row_size, rows * row_size);
+
+            VkBufferImageCopy region = {};
+            region.bufferOffset = staged.offset;
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = base_level;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = 1;
+            region.imageOffset = { 0, (int32_t)y, 0 };
+            region.imageExtent = { width, rows, 1 };
+            vkCmdCopyBufferToImage(open_batch(), staged.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+        }
+        VkCommandBuffer command_buffer = open_batch();
+
+        // Mips are generated on the graphics queue, so a mipmapped image stays in TRANSFER_DST until then
+        if (mip_info)
+        {
+            mip_chain chain = { image, mip_info->format, mip_info->usage, mip_info->flags, width, height, level_count, final_layout, dst_stage, dst_access };
+            current.mip_chains.push_back(chain);
+            final_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            dst_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            dst_access = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        }
+
+        // With an ownership transfer the layout change is specified identically on both queues and happens once
+        VkImageMemoryBarrier release = barrier;
+        release.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        release.newLayout = final_layout;
+        release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        release.dstAccessMask = 0;
+        release.srcQueueFamilyIndex = ownership_transfer() ? transfer.family_index : VK_QUEUE_FAMILY_IGNORED;
+        release.dstQueueFamilyIndex = ownership_transfer() ? graphics.family_index : VK_QUEUE_FAMILY_IGNORED;
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                             0, nullptr, 0, nullptr, 1, &release);
+
+        if (ownership_transfer())
+        {
+            VkImageMemoryBarrier acquire = release;
+            acquire.srcAccessMask = 0;
+            acquire.dstAccessMask = dst_access;
+            current.image_acquires.push_back(acquire);
+        }
+        current.dst_stages |= dst_stage;
+
+        upload_ticket ticket;
+        ticket.id = ++next_ticket;
+        ticket.transfer_value = transfer_timeline.last_submitted() + 1;
+        current.last_ticket = ticket.id;
+
+        return ticket;
+    }
+    void upload_engine::flush()
+    {
+        if (recording == VK_NULL_HANDLE)
+            return;
+
+        if (vkEndCommandBuffer(recording) != VK_SUCCESS)
+            throw std::runtime_error("Failed to record upload command buffer");
+
+        uint64_t value = transfer_timeline.next();
+        if (timeline_submit().command_buffer(recording).signal(transfer_timeline, value).submit(transfer.vk_queue) != VK_SUCCESS)
+            throw std::runtime_error("Failed to submit upload command buffer");
+
+        VkDevice device = vk_device;
+        VkCommandPool pool = transfer_pool;
+        VkCommandBuffer command_buffer = recording;
+        transfer_garbage.defer(value, [device, pool, command_buffer]() { vkFreeCommandBuffers(device, pool, 1, &command_buffer); });
+        staging.retire(value);
+
+        current.transfer_value = value;
+        in_flight.push_back(current);
+        current = batch();
+        recording = VK_NULL_HANDLE;
+    }
+    void upload_engine::update()
+    {
+        flush();
+
+        uint64_t completed = transfer_timeline.completed();
+        transfer_garbage.collect(completed);
+        staging.recycle(completed);
+        graphics_garbage.collect(graphics_timeline->completed());
+        if (mips)
+            mips->collect(graphics_timeline->completed());
+
+        // Only finished batches are acquired, so the graphics queue never waits on a transfer still running
+        std::vector<VkBufferMemoryBarrier> buffer_barriers;
+        std::vector<VkImageMemoryBarrier> image_barriers;
+        std::vector<mip_chain> mip_chains;
+        VkPipelineStageFlags dst_stages = 0;
+        uint64_t wait_value = 0;
+        uint64_t last_ticket = 0;
+        while (!in_flight.empty() && in_flight.front().transfer_value <= completed)
+        {
+            const batch & done = in_flight.front();
+            buffer_barriers.insert(buffer_barriers.end(), done.buffer_acquires.begin(), done.buffer_acquires.end());
+            image_barriers.insert(image_barriers.end(), done.image_acquires.begin(), done.image_acquires.end());
+            mip_chains.insert(mip_chains.end(), done.mip_chains.begin(), done.mip_chains.end());
+            dst_stages |= done.dst_stages;
+            wait_value = done.transfer_value;
+            // Batches flushed early to free staging buffers can end before any upload does
+            if (done.last_ticket != 0)
+                last_ticket = done.last_ticket;
+            in_flight.pop_front();
+        }
+        if (last_ticket == 0)
+            return;
+
+        // The semaphore wait is already satisfied but still makes the transfer writes visible to the graphics queue
+        timeline_submit submit;
+        submit.wait(transfer_timeline, wait_value, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+        VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+        if (!buffer_barriers.empty() || !image_barriers.empty() || !mip_chains.empty())
+        {
+            command_buffer = allocate(graphics_pool);
+            if (!buffer_barriers.empty() || !image_barriers.empty())
+                vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dst_stages, 0, 0, nullptr,
+                                     (uint32_t)buffer_barriers.size(), buffer_barriers.data(), (uint32_t)image_barriers.size(), image_barriers.data());
+            // Every level arrives in TRANSFER_DST, acquired for transfers or made visible by the semaphore wait
+            if (!mip_chains.empty())
+                mips->record(command_buffer, mip_chains,
+                             { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL });
+            if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+                throw std::runtime_error("Failed to record acquire command buffer");
+            submit.command_buffer(command_buffer);
+        }
+
+        uint64_t value = graphics_timeline->next();
+        if (submit.signal(*graphics_timeline, value).submit(graphics.vk_queue) != VK_SUCCESS)
+            throw std::runtime_error("Failed to submit acquire barriers");
+
+        if (command_buffer != VK_NULL_HANDLE)
+        {
+            VkDevice device = vk_device;
+            VkCommandPool pool = graphics_pool;
+            graphics_garbage.defer(value, [device, pool, command_buffer]() { vkFreeCommandBuffers(device, pool, 1, &command_buffer); });
+        }
+        if (!mip_chains.empty())
+            mips->retire(value);
+        acquired_ticket = last_ticket;
+    }
+    void upload_engine::wait(const upload_ticket & ticket)
+    {
+        if (ready(ticket))
+            return;
+        flush();
+        transfer_timeline.wait(ticket.transfer_value);
+        update();
+    }
+    VkCommandBuffer upload_engine::open_batch()
+    {
+        if (recording == VK_NULL_HANDLE)
+            recording = allocate(transfer_pool);
+        return recording;
+    }
+    VkCommandBuffer upload_engine::allocate(VkCommandPool pool)
+    {
+        VkCommandBufferAllocateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        info.commandPool = pool;
+        info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        info.commandBufferCount = 1;
+
+        VkCommandBuffer command_buffer;
+        if (vkAllocateCommandBuffers(vk_device, &info, &command_buffer) != VK_SUCCESS)
+            throw std::runtime_error("Failed to allocate upload command buffer");
+
+        VkCommandBufferBeginInfo begin_info = {};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(command_buffer, &begin_info);
+        return command_buffer;
+    }
+    staging_region upload_engine::stage(const void * data, VkDeviceSize size)
+    {
+        staging_region region;
+        while (!staging.acquire(size, region))
+        {
+            // Every staging buffer is in flight, so submit what this batch has and wait for the oldest one
+            flush();
+            transfer_timeline.wait(staging.oldest_pending());
+            staging.recycle(transfer_timeline.completed());
+        }
+        std::memcpy(region.mapped, data, (size_t)size);
+        return region;
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef LVK_UPLOAD_ENGINE_H
+#define LVK_UPLOAD_ENGINE_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <deque>
+
+#include "queue.h"
+#include "timeline.h"
+#include "staging_pool.h"
+#include "mip_generator.h"
+
+namespace lvk
+{
+    class physical_device;
+    class memory_allocator;
+
+    struct upload_ticket
+    {
+        uint64_t id = 0;
+        uint64_t transfer_value = 0;
+    };
+
+    // Uploads buffers and images on a transfer queue without blocking the caller. Copies
+    // are batched until flush() and signal the engine's transfer timeline. Once a batch
+    // has completed, update() submits the matching queue family acquire barriers on the
+    // graphics queue, after which a ticket is ready() for any later graphics submission.
+    // If both queues share a family no ownership transfer is needed and only the
+    // timeline handoff remains. Data is copied through a bounded staging_pool; uploads
+    // larger than one staging buffer are split, and when every staging buffer is in
+    // flight the engine submits what it has and waits for the oldest one to come back.
+    // Mipmapped uploads need a mip_generator, whose work rides along in the acquire
+    // submissions.
+    class upload_engine
+    {
+    public:
+        upload_engine() = default;
+        upload_engine(VkDevice device, const physical_device & physical_device, memory_allocator & allocator, queue transfer_queue, queue graphics_queue,
+                      timeline & graphics_timeline, mip_generator * mips = nullptr);
+        void destroy();
+
+        upload_ticket upload_buffer(VkBuffer buffer, const void * data, VkDeviceSize size, VkDeviceSize offset,
+                                    VkPipelineStageFlags dst_stage, VkAccessFlags dst_access);
+        // Copies the pixels into mip level 0 and leaves all mip_levels in final_layout on the graphics queue
+        upload_ticket upload_image(VkImage image, const void * data, VkDeviceSize size, uint32_t width, uint32_t height, uint32_t mip_levels,
+                                   VkImageLayout final_layout, VkPipelineStageFlags dst_stage, VkAccessFlags dst_access);
+        // Same, but fills the other levels from level 0 with the mip generator, recorded into the
+        // graphics submission that acquires the batch, so a batch of textures is copied in one
+        // transfer submission and mipmapped in one graphics submission. info is what the image
+        // was created with; its format, usage and flags decide between compute and blits. Only
+        // levels below level_count are touched, so smaller ones can be uploaded separately.
+        upload_ticket upload_image_with_mipmaps(VkImage image, const void * data, VkDeviceSize size, const VkImageCreateInfo & info, uint32_t level_count,
+                                                VkImageLayout final_layout, VkPipelineStageFlags dst_stage, VkAccessFlags dst_access);
+        bool generates_mipmaps() const { return mips != nullptr; }
+        // Copies the pixels into one mip level of the given extent and leaves only that level in final_layout
+        upload_ticket upload_image_level(VkImage image, const void * data, VkDeviceSize size, uint32_t width, uint32_t height, uint32_t level,
+                                         VkImageLayout final_layout, VkPipelineStageFlags dst_stage, VkAccessFlags dst_access);
+
+        void flush();
+        void update();
+        void wait(const upload_ticket & ticket);
+
+        bool ready(const upload_ticket & ticket) const { return ticket.id <= acquired_ticket; }
+        bool transfers_complete(const upload_ticket & ticket) const { return transfer_timeline.reached(ticket.transfer_value); }
+        bool ownership_transfer() const { return transfer.family_index != graphics.family_index; }
+        const timeline & transfer_timeline_semaphore() const { return transfer_timeline; }
+        staging_pool_stats staging_stats() const { return staging.stats(); }
+    private:
+        struct batch
+        {
+            uint64_t transfer_value = 0;
+            uint64_t last_ticket = 0;
+            std::vector<VkBufferMemoryBarrier> buffer_acquires;
+            std::vector<VkImageMemoryBarrier> image_acquires;
+            std::vector<mip_chain> mip_chains;
+            VkPipelineStageFlags dst_stages = 0;
+        };
+
+        upload_ticket record_image_upload(VkImage image, const void * data, VkDeviceSize size, uint32_t width, uint32_t height,
+                                          uint32_t base_level, uint32_t level_count, VkImageLayout final_layout, VkPipelineStageFlags dst_stage,
+                                          VkAccessFlags dst_access, const VkImageCreateInfo * mip_info);
+        VkCommandBuffer open_batch();
+        VkCommandBuffer allocate(VkCommandPool pool);
+        // May flush the open batch, so command buffers from open_batch() must be fetched again afterwards
+        staging_region stage(const void * data, VkDeviceSize size);
+
+        VkDevice vk_device = VK_NULL_HANDLE;
+        queue transfer;
+        queue graphics;
+        timeline * graphics_timeline = nullptr;
+        mip_generator * mips = nullptr;
+        timeline transfer_timeline;
+        staging_pool staging;
+        VkCommandPool transfer_pool = VK_NULL_HANDLE;
+        VkCommandPool graphics_pool = VK_NULL_HANDLE;
+
+        VkCommandBuffer recording = VK_NULL_HANDLE;
+        batch current;
+        std::deque<batch> in_flight;
+        deferred_queue transfer_garbage;
+        deferred_queue graphics_garbage;
+        uint64_t next_ticket = 0;
+        uint64_t acquired_ticket = 0;
+    };
+}
+
+#endif
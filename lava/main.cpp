@@ -1,13 +1,213 @@
 #include <memory>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cstdint>
 #include "app.h"
+#include "renderer.h"
+
+static constexpr int LAVA_EVENT_WAIT_MS = 10;
+
+static bool parse_present_policy(const char * name, lvk::present_policy & policy)
+{
+    if (strcmp(name, "low-latency") == 0) policy = lvk::present_policy::low_latency;
+    else if (strcmp(name, "max-throughput") == 0) policy = lvk::present_policy::max_throughput;
+    else if (strcmp(name, "vsync") == 0) policy = lvk::present_policy::vsync_strict;
+    else if (strcmp(name, "vsync-relaxed") == 0) policy = lvk::present_policy::vsync_relaxed;
+    else return false;
+    return true;
+}
+
+// Accepts only a whole decimal number that fits, unlike atoi which turns anything else into 0
+static bool parse_uint(const char * text, uint32_t & value)
+{
+    if (!text || *text < '0' || *text > '9')
+        return false;
+    char * end = nullptr;
+    unsigned long long parsed = std::strtoull(text, &end, 10);
+    if (*end != '\0' || parsed > UINT32_MAX)
+        return false;
+    value = (uint32_t)parsed;
+    return true;
+}
 
 int main(int argc, char** argv)
 {
     auto app = std::make_unique<lava::App>("lava renderer", 1280, 720);
-    while (app->running)
+
+    uint32_t benchmark_draws = 0;
+    uint32_t benchmark_job_draws = 0;
+    uint32_t benchmark_mip_size = 0;
+    bool render_thread = false;
+    bool memory_stats = false;
+    bool startup_stats = false;
+    // Settings are only collected here and applied once every argument is read, so their order doesn't matter
+    uint32_t frames_in_flight = 0;
+    bool present_policy_set = false;
+    lvk::present_policy present_policy = lvk::present_policy::low_latency;
+    bool per_frame_recording = false;
+    bool gpu_culling = true;
+    bool memory_limited = false;
+    uint32_t memory_limit_mb = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc)
+        {
+            if (!parse_uint(argv[++i], frames_in_flight) || frames_in_flight == 0)
+            {
+                fprintf(stderr, "--frames-in-flight expects a whole number of at least 1, got '%s'\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--present-policy") == 0 && i + 1 < argc)
+        {
+            if (!parse_present_policy(argv[++i], present_policy))
+            {
+                fprintf(stderr, "--present-policy expects low-latency, max-throughput, vsync or vsync-relaxed, got '%s'\n", argv[i]);
+                return 1;
+            }
+            present_policy_set = true;
+        }
+        else if (strcmp(argv[i], "--per-frame-recording") == 0)
+            per_frame_recording = true;
+        else if (strcmp(argv[i], "--no-gpu-culling") == 0)
+            gpu_culling = false;
+        else if (strcmp(argv[i], "--benchmark-recording") == 0 && i + 1 < argc)
+            benchmark_draws = (uint32_t)std::atoi(argv[++i]);
+        else if (strcmp(argv[i], "--render-thread") == 0)
+            render_thread = true;
+        else if (strcmp(argv[i], "--benchmark-jobs") == 0 && i + 1 < argc)
+            benchmark_job_draws = (uint32_t)std::atoi(argv[++i]);
+        else if (strcmp(argv[i], "--benchmark-mipmaps") == 0 && i + 1 < argc)
+            benchmark_mip_size = (uint32_t)std::atoi(argv[++i]);
+        else if (strcmp(argv[i], "--memory-stats") == 0)
+            memory_stats = true;
+        else if (strcmp(argv[i], "--startup-stats") == 0)
+            startup_stats = true;
+        else if (strcmp(argv[i], "--memory-limit-mb") == 0 && i + 1 < argc)
+        {
+            // A limit of 0 would mean no limit at all, which is never what was asked for
+            if (!parse_uint(argv[++i], memory_limit_mb) || memory_limit_mb == 0)
+            {
+                fprintf(stderr, "--memory-limit-mb expects a whole number of at least 1, got '%s'\n", argv[i]);
+                return 1;
+            }
+            memory_limited = true;
+        }
+    }
+
+    // A present policy resets the frame count to what its swapchain recommends, so an explicit count goes after it
+    if (present_policy_set)
+        app->renderer->set_present_policy(present_policy);
+    if (frames_in_flight > 0)
+        app->renderer->set_frames_in_flight(frames_in_flight);
+    if (per_frame_recording)
+        app->renderer->set_recording_mode(lava::RecordingMode::per_frame);
+    if (!gpu_culling)
+        app->renderer->set_gpu_culling(false);
+
+    // Caps this instance's device local budget so several can share a GPU. Applied after the settings
+    // above, which may recreate resources, so the first update already sees what they allocated.
+    if (memory_limited)
     {
-        app->poll_events();
-        app->draw_frame();
+        lvk::memory_budget & budget = app->renderer->memory_budget();
+        for (const auto & heap : budget.heaps())
+            if (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+                budget.set_limit(heap.heap, (VkDeviceSize)memory_limit_mb * 1024 * 1024);
+        budget.update();
+    }
+
+    if (startup_stats)
+    {
+        // Work adds up to more than the wall time by however much the tasks overlapped
+        double work_ms = 0.0;
+        for (const auto & task : app->renderer->startup_timings())
+        {
+            printf("startup %s: %.2f ms, started at %.2f ms\n", task.name.c_str(), task.duration_ms, task.start_ms);
+            work_ms += task.duration_ms;
+        }
+        printf("startup: %.2f ms, %.2f ms of work\n", app->renderer->startup_time(), work_ms);
+    }
+
+    if (benchmark_job_draws > 0)
+    {
+        for (const auto & result : app->renderer->benchmark_jobs(benchmark_job_draws, 20))
+            printf("%u draws, %u workers: %.3f ms per iteration, %.2fx speedup\n", result.draws, result.workers, result.ms_per_iteration, result.speedup);
+        app.reset();
+        return 0;
+    }
+
+    if (benchmark_mip_size > 0)
+    {
+        for (const auto & result : app->renderer->benchmark_mipmaps(benchmark_mip_size, 20))
+            printf("%ux%u, %u levels, %s: %.3f ms on the GPU, %.3f ms recording\n", result.size, result.size, result.mip_levels,
+                   result.path == lvk::mip_generation_path::compute ? "compute" : "blit", result.gpu_ms, result.record_ms);
+        app.reset();
+        return 0;
+    }
+
+    if (benchmark_draws > 0)
+    {
+        for (const auto & result : app->renderer->benchmark_recording(benchmark_draws, 100))
+            printf("%u draws, %u workers: %.3f ms per frame, %.1f ns per draw\n", result.draws, result.workers, result.ms_per_frame, result.ns_per_draw);
+        app.reset();
+        return 0;
+    }
+
+    if (render_thread)
+    {
+        // Event latency no longer depends on how long the GPU takes to hand back a frame
+        app->start_render_thread();
+        while (app->running)
+            app->wait_events(LAVA_EVENT_WAIT_MS);
+        app->stop_render_thread();
+    }
+    else
+    {
+        while (app->running)
+        {
+            app->poll_events();
+            app->draw_frame();
+        }
+    }
+
+    if (memory_stats)
+    {
+        lvk::memory_allocator_stats stats = app->renderer->memory_stats();
+        printf("%u device allocations (%u blocks, %u dedicated) for %u sub-allocations\n",
+               stats.device_allocations, stats.blocks, stats.dedicated_allocations, stats.allocations);
+        printf("%.1f of %.1f MB block memory used, %.1f MB dedicated, %u free ranges, %.1f%% fragmentation\n",
+               stats.used_bytes / (1024.0 * 1024.0), stats.block_bytes / (1024.0 * 1024.0), stats.dedicated_bytes / (1024.0 * 1024.0),
+               stats.free_ranges, stats.fragmentation() * 100.0f);
+
+        lvk::render_graph_memory_stats targets = app->renderer->render_target_memory_stats();
+        printf("render targets: %u images need %.1f MB, %.1f MB allocated in %u blocks (%u lazily allocated, %.1f MB committed), %.1f MB saved\n",
+               targets.images, targets.required / (1024.0 * 1024.0), targets.allocated / (1024.0 * 1024.0), targets.blocks, targets.lazy_blocks,
+               targets.lazy_committed / (1024.0 * 1024.0), targets.saved() / (1024.0 * 1024.0));
+
+        const lvk::defragmenter_stats & defrag = app->renderer->defragmentation_stats();
+        printf("defragmentation: %u moves, %.1f MB moved, %u blocks released\n",
+               defrag.moves, defrag.bytes_moved / (1024.0 * 1024.0), defrag.blocks_released);
+
+        lvk::staging_pool_stats staging = app->renderer->staging_stats();
+        printf("staging: %u buffers (%.1f MB), %u in flight, %llu recycled, %llu stalls\n", staging.buffers, staging.bytes / (1024.0 * 1024.0),
+               staging.in_flight, (unsigned long long)staging.recycled, (unsigned long long)staging.stalls);
+
+        lvk::memory_budget & budget = app->renderer->memory_budget();
+        budget.update();
+        for (const auto & heap : budget.heaps())
+            printf("heap %u%s: %.1f of %.1f MB budget used (%s)\n", heap.heap, (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? " (device local)" : "",
+                   heap.usage / (1024.0 * 1024.0), heap.budget / (1024.0 * 1024.0), budget.driver_reported() ? "driver" : "internal");
+
+        lvk::host_allocator_stats host = lvk::host_allocator::global().stats();
+        for (uint32_t scope = 0; scope < lvk::HOST_SCOPE_COUNT; scope++)
+            printf("host %s scope: %llu allocations, %llu live, %.1f KB live, %.1f KB high water, %.1f KB reported by the driver\n",
+                   lvk::host_scope_name((VkSystemAllocationScope)scope), (unsigned long long)host.scopes[scope].allocations,
+                   (unsigned long long)host.scopes[scope].live, host.scopes[scope].bytes / 1024.0, host.scopes[scope].high_water / 1024.0,
+                   host.internal_scopes[scope].bytes / 1024.0);
+        printf("host: %llu arena, %llu pool, %llu heap allocations, %.1f KB pooled, %.1f KB reported by the driver\n",
+               (unsigned long long)host.arena_allocations, (unsigned long long)host.pool_allocations, (unsigned long long)host.heap_allocations,
+               host.pool_reserved / 1024.0, host.internal.bytes / 1024.0);
     }
 
     app.reset();
@@ -13,6 +13,7 @@
 #include "lvk/render_pass.h"
 
 #include <fstream>
+#include <iostream>
 #include <unordered_map>
 
 #define GLM_FORCE_RADIANS
@@ -26,6 +27,8 @@
 #include <stb/stb_image.h>
 #include <tinyobj/tinyobjloader.h>
 #include <bitset>
+#include <thread>
+#include <algorithm>
 
 std::string MODEL_PATH = "models/viking_room.obj";
 std::string TEXTURE_PATH = "textures/viking_room.png";
@@ -78,7 +81,12 @@ static constexpr bool HAS_STENCIL_COMPONENT(VkFormat format)
     return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
 }
 
-static constexpr int LAVA_MAX_FRAMES_IN_FLIGHT = 2;
+static constexpr lvk::present_policy LAVA_DEFAULT_PRESENT_POLICY = lvk::present_policy::low_latency;
+static constexpr uint32_t LAVA_TRIANGLES_PER_DRAW = 256;
+static constexpr uint32_t LAVA_MIN_DRAWS_PER_WORKER = 4;
+static constexpr uint32_t LAVA_BOUNDS_PER_JOB = 16;
+static constexpr VkDeviceSize LAVA_FRAME_RING_REGION_SIZE = 256 * 1024;
+static constexpr uint64_t LAVA_MEMORY_BUDGET_INTERVAL = 30;
 
 static std::vector<char> load_file(const std::string filename)
 {
@@ -96,12 +104,71 @@ static std::vector<char> load_file(const std::string filename)
 }
 
 Renderer::Renderer(App * app)
+{
+    sdl_window = app->sdl_window;
+
+    present_policy = LAVA_DEFAULT_PRESENT_POLICY;
+    command_recording_mode = RecordingMode::prerecorded;
+    static_draws_version = 0;
+    gpu_culling_enabled = true;
+    texture_error_reported = false;
+    geometry_version = 0;
+    geometry_release_pending = false;
+
+    // Startup is a graph on the job system: parsing the model overlaps instance and device creation, and the
+    // pipelines compile while the geometry uploads. Tasks only touch members their dependencies are done with;
+    // the memory allocator locks, and the upload engine is only used by the device and geometry tasks.
+    lvk::task_graph startup;
+    uint32_t instance_task = startup.add("instance", [this]() { create_instance(); });
+    uint32_t model_task = startup.add("model", [this]() { load_model(); });
+    uint32_t device_task = startup.add("device", [this]() { create_device(); }, { instance_task });
+    uint32_t swapchain_task = startup.add("swapchain", [this]() { create_swapchain(); }, { device_task });
+    uint32_t render_graph_task = startup.add("render graph", [this]() { create_render_graph(); }, { swapchain_task });
+    uint32_t graphics_pipeline_task = startup.add("graphics pipeline", [this]() { create_graphics_pipeline(); }, { render_graph_task });
+    uint32_t cull_pipeline_task = startup.add("cull pipeline", [this]() { create_cull_pipeline(); }, { device_task });
+    uint32_t command_pool_task = startup.add("command pool", [this]() { create_command_pool(); }, { swapchain_task });
+    uint32_t gpu_profiler_task = startup.add("gpu profiler", [this]() { create_gpu_profiler(); }, { swapchain_task });
+    uint32_t render_targets_task = startup.add("render targets", [this]() { create_render_graph_resources(); }, { render_graph_task });
+    // The texture streams in on the streamer's own threads and isn't waited for at all
+    uint32_t texture_task = startup.add("texture", [this]()
+    {
+        stream_texture();
+        create_texture_sampler();
+    }, { device_task });
+    uint32_t geometry_task = startup.add("geometry", [this]()
+    {
+        create_draw_bounds_buffer();
+        create_vertex_buffer();
+        create_index_buffer();
+        // Loading blocks once, until the geometry and the placeholder texture are owned by the graphics queue; later uploads are polled with ready()
+        upload_engine.wait(scene_upload);
+    }, { device_task, model_task });
+    uint32_t uniform_buffers_task = startup.add("uniform buffers", [this]() { create_uniform_buffers(); }, { swapchain_task });
+    uint32_t descriptors_task = startup.add("descriptors", [this]()
+    {
+        create_descriptor_pool();
+        create_descriptor_sets();
+    }, { uniform_buffers_task, texture_task });
+    uint32_t cull_resources_task = startup.add("cull resources", [this]() { create_cull_resources(); }, { swapchain_task, geometry_task, cull_pipeline_task });
+    uint32_t sync_objects_task = startup.add("sync objects", [this]() { create_sync_objects(); }, { swapchain_task });
+    startup.add("command buffers", [this]() { create_command_buffers(); },
+                { graphics_pipeline_task, command_pool_task, gpu_profiler_task, render_targets_task, descriptors_task, cull_resources_task,
+                  sync_objects_task });
+
+    startup.run(jobs);
+    startup_tasks = startup.timings();
+    startup_time_ms = startup.elapsed_ms();
+
+    window_resized = false;
+}
+
+void Renderer::create_instance()
 {
     // Query extensions needed by SDL
     uint32_t sdl_required_extension_count;
-    SDL_Vulkan_GetInstanceExtensions(app->sdl_window, &sdl_required_extension_count, nullptr);
+    SDL_Vulkan_GetInstanceExtensions(sdl_window, &sdl_required_extension_count, nullptr);
     std::vector<const char *> requested_extensions(sdl_required_extension_count);
-    SDL_Vulkan_GetInstanceExtensions(app->sdl_window, &sdl_required_extension_count, requested_extensions.data());
+    SDL_Vulkan_GetInstanceExtensions(sdl_window, &sdl_required_extension_count, requested_extensions.data());
     std::vector<const char *> requested_layers;
 
 #if USE_VALIDATION
@@ -123,11 +190,18 @@ Renderer::Renderer(App * app)
     debug_messenger = lvk_instance.get_debug_messenger();
 #endif
 
-    window_surface = lvk_instance.create_sdl_window_surface(app->sdl_window);
+    window_surface = lvk_instance.create_sdl_window_surface(sdl_window);
+}
 
+void Renderer::create_device()
+{
     VkPhysicalDeviceFeatures requested_device_features = {};
     requested_device_features.samplerAnisotropy = VK_TRUE;
 
+    // Timeline semaphores are a required feature of Vulkan 1.2, but still have to be enabled
+    VkPhysicalDeviceVulkan12Features requested_device_features12 = {};
+    requested_device_features12.timelineSemaphore = VK_TRUE;
+
     using namespace lvk::literals;
 
     lvk_physical_device = lvk_instance.select_physical_device()
@@ -143,74 +217,64 @@ Renderer::Renderer(App * app)
 
     msaa_samples = lvk_physical_device.max_usable_sample_count();
 
+    // Culled draws are issued with one indirect call per worker range when the device allows it
+    VkPhysicalDeviceFeatures multi_draw_features = {};
+    multi_draw_features.multiDrawIndirect = VK_TRUE;
+    multi_draw_indirect = lvk_physical_device.supports_features(multi_draw_features);
+    requested_device_features.multiDrawIndirect = multi_draw_indirect ? VK_TRUE : VK_FALSE;
+
     // Find main graphics queue with present capabilities
     graphics_queue_family_index = lvk_physical_device.compatible_queue_family_index(VK_QUEUE_GRAPHICS_BIT);
     present_queue_family_index = lvk_physical_device.queue_family_supports_present(graphics_queue_family_index) ?
                                             graphics_queue_family_index : lvk_physical_device.present_queue_family_index();
+
+    // Uploads go to a family without graphics (usually the DMA engine) when there is one, otherwise they share the graphics queue
+    transfer_queue_family_index = lvk_physical_device.has_mutually_exclusive_queue_family(VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT) ?
+                                            lvk_physical_device.mutually_exclusive_queue_family_index(VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT) :
+                                            graphics_queue_family_index;
     
     lvk::device_builder device_builder(lvk_physical_device);
     device_builder
         .extension(VK_KHR_SWAPCHAIN_EXTENSION_NAME)
         .features(requested_device_features)
-        .queues(graphics_queue_family_index, 1);
+        .features12(requested_device_features12)
+        .queues(graphics_queue_family_index, 1)
+        .async_compute_queue();
+    // Budget numbers from the driver include other processes, the internal fallback can't see them
+    bool memory_budget_supported = lvk_physical_device.supports_extension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (memory_budget_supported)
+        device_builder.extension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
     if (graphics_queue_family_index != present_queue_family_index)
         device_builder.queues(present_queue_family_index, 1);
+    if (transfer_queue_family_index != graphics_queue_family_index && transfer_queue_family_index != present_queue_family_index)
+        device_builder.queues(transfer_queue_family_index, 1);
 
     lvk_device = device_builder.build();
     device = lvk_device.vk();
 
     vkGetDeviceQueue(device, graphics_queue_family_index, 0, &graphics_queue);
     vkGetDeviceQueue(device, present_queue_family_index, 0, &present_queue);
-
-    sdl_window = app->sdl_window;
-
-    int draw_width = 0, draw_height = 0;
-    SDL_Vulkan_GetDrawableSize(sdl_window, &draw_width, &draw_height);
-
-    lvk_swapchain = lvk::swapchain_builder(lvk_device, lvk_physical_device)
-        .size((uint32_t)draw_width, (uint32_t)draw_height)
-        .image_usage(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)
-        .composite_alpha(VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR)
-        .clipped(VK_TRUE)
-        .graphics_family_index(graphics_queue_family_index)
-        .present_family_index(present_queue_family_index)
-        .build();
-    swapchain = lvk_swapchain.vk();    
+    vkGetDeviceQueue(device, transfer_queue_family_index, 0, &transfer_queue);
+    compute_queue = lvk_device.async_compute_queue();
+
+    memory_allocator = lvk::memory_allocator(lvk_device, lvk_physical_device);
+    lvk_memory_budget = lvk::memory_budget(lvk_physical_device, memory_allocator, memory_budget_supported);
+    graphics_timeline = lvk::timeline(device);
+    compute_timeline = lvk::timeline(device);
+    mip_generator = lvk::mip_generator(device, lvk_physical_device, load_file("shaders/mipgen.spv"));
+    upload_engine = lvk::upload_engine(device, lvk_physical_device, memory_allocator, { transfer_queue, transfer_queue_family_index },
+                                       { graphics_queue, graphics_queue_family_index }, graphics_timeline, &mip_generator);
+    texture_streamer = lvk::texture_streamer(device, memory_allocator, upload_engine, VK_FORMAT_R8G8B8A8_SRGB);
+    texture_streamer.watch_budget(lvk_memory_budget);
+    defragmenter = lvk::defragmenter(device, memory_allocator, { graphics_queue, graphics_queue_family_index }, graphics_timeline);
+    // Recordings switch to moved geometry one image at a time, see refresh_image_bindings()
+    defragmenter.set_hold_replaced(true);
 
     lvk_descriptor_set_layout = lvk::descriptor_set_layout_builder()
-        .uniform_buffer(0, 1, VK_SHADER_STAGE_VERTEX_BIT)
+        .uniform_buffer_dynamic(0, 1, VK_SHADER_STAGE_VERTEX_BIT)
         .combined_image_sampler(1, 1, VK_SHADER_STAGE_FRAGMENT_BIT)
         .build(lvk_device);
     descriptor_set_layout = lvk_descriptor_set_layout.vk();
-
-    render_pass = lvk::render_pass_builder()
-                    .attachment(0, lvk::attachment::color, lvk_swapchain.image_format(), msaa_samples)
-                    .attachment(1, lvk::attachment::depth, find_depth_format(), msaa_samples)
-                    .attachment(2, lvk::attachment::resolve, lvk_swapchain.image_format(), VK_SAMPLE_COUNT_1_BIT)
-                    .subpass(0, lvk::pipeline::bind_point::graphics, { 0 }, { 1 }, { 2 })
-                    .subpass_dependency(VK_SUBPASS_EXTERNAL, 0, lvk::pipeline::stage::color_attachment_output, lvk::access::none, 
-                                        lvk::pipeline::stage::color_attachment_output, lvk::access::color_attachment_write)
-                    .build(lvk_device).vk();
-
-    create_graphics_pipeline();
-    create_command_pool();
-    create_color_resources();
-    create_depth_resources();
-    create_framebuffers();
-    create_texture_image();
-    create_texture_image_view();
-    create_texture_sampler();
-    load_model();
-    create_vertex_buffer();
-    create_index_buffer();
-    create_uniform_buffers();
-    create_descriptor_pool();
-    create_descriptor_sets();
-    create_command_buffers();
-    create_sync_objects();
-
-    current_frame = 0;
-    window_resized = false;
 }
 
 VkPhysicalDevice Renderer::select_optimal_physical_device(const std::vector<VkPhysicalDevice> & physical_devices)
@@ -343,7 +407,7 @@ void Renderer::create_graphics_pipeline()
     pipeline_layout_info.setLayoutCount = 1;
     pipeline_layout_info.pSetLayouts = &descriptor_set_layout;
 
-    if (vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &pipeline_layout) != VK_SUCCESS)
+    if (vkCreatePipelineLayout(device, &pipeline_layout_info, lvk::host_callbacks(), &pipeline_layout) != VK_SUCCESS)
         throw std::runtime_error("Failed to create pipeline layout");
 
     VkGraphicsPipelineCreateInfo pipeline_info = {};
@@ -366,34 +430,41 @@ void Renderer::create_graphics_pipeline()
     pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
     pipeline_info.basePipelineIndex = -1;
 
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &graphics_pipeline) != VK_SUCCESS)
+    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, lvk::host_callbacks(), &graphics_pipeline) != VK_SUCCESS)
         throw std::runtime_error("Failed to create graphcs pipeline");
 
-    vkDestroyShaderModule(device, vertex_shader, nullptr);
-    vkDestroyShaderModule(device, fragment_shader, nullptr);
+    vkDestroyShaderModule(device, vertex_shader, lvk::host_callbacks());
+    vkDestroyShaderModule(device, fragment_shader, lvk::host_callbacks());
 }
 
-void Renderer::create_framebuffers()
+void Renderer::create_render_graph()
 {
-    swapchain_framebuffers.resize(lvk_swapchain.get_image_views().size());
-    for (int i = 0; i < lvk_swapchain.get_image_views().size(); i++)
-    {
-        // we only need one depth image instead of the swapchain length because only a single subpass is
-        // running at the same time due to semaphores
-        std::array<VkImageView, 3> attachments = { color_image_view, depth_image_view, lvk_swapchain.get_image_views()[i].vk() };
-
-        VkFramebufferCreateInfo framebuffer_info = {};
-        framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebuffer_info.renderPass = render_pass;
-        framebuffer_info.attachmentCount = (uint32_t)attachments.size();
-        framebuffer_info.pAttachments = attachments.data();
-        framebuffer_info.width = lvk_swapchain.image_extent().width;
-        framebuffer_info.height = lvk_swapchain.image_extent().height;
-        framebuffer_info.layers = 1;
-
-        if (vkCreateFramebuffer(device, &framebuffer_info, nullptr, &swapchain_framebuffers[i]) != VK_SUCCESS)
-            throw std::runtime_error("Failed to create framebuffer");
-    }
+    render_graph = lvk::render_graph(lvk_device, lvk_physical_device, memory_allocator);
+
+    // Only a single frame renders at a time on the graphics queue, so one set of attachments serves every swapchain image
+    lvk::render_graph::resource color = render_graph.create_image("color", lvk_swapchain.image_format(), msaa_samples, VK_IMAGE_ASPECT_COLOR_BIT);
+    lvk::render_graph::resource depth = render_graph.create_image("depth", find_depth_format(), msaa_samples, VK_IMAGE_ASPECT_DEPTH_BIT);
+    backbuffer = render_graph.import_image("backbuffer", lvk_swapchain.image_format(), VK_SAMPLE_COUNT_1_BIT,
+                                           VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+    forward_pass = render_graph.add_pass("forward")
+        .color(color, lvk::render_graph_load::clear, { { 0.0f, 0.0f, 0.0f, 1.0f } })
+        .depth(depth, lvk::render_graph_load::clear)
+        .resolve(backbuffer)
+        .contents(VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS)
+        .id();
+
+    render_graph.compile();
+    render_pass = render_graph.pass_render_pass(forward_pass);
+}
+
+void Renderer::create_render_graph_resources()
+{
+    std::vector<VkImageView> views;
+    for (const auto & view : lvk_swapchain.get_image_views())
+        views.push_back(view.vk());
+    render_graph.bind_imported(backbuffer, views);
+    render_graph.create_resources(lvk_swapchain.image_extent());
 }
 
 void Renderer::create_command_pool()
@@ -404,72 +475,30 @@ void Renderer::create_command_pool()
     pool_info.queueFamilyIndex = queue_family_info.graphics_family;
     pool_info.flags = 0;
 
-    if (vkCreateCommandPool(device, &pool_info, nullptr, &command_pool) != VK_SUCCESS)
+    if (vkCreateCommandPool(device, &pool_info, lvk::host_callbacks(), &command_pool) != VK_SUCCESS)
         throw std::runtime_error("Failed to create command pool");
-}
 
-void Renderer::create_color_resources()
-{
-    VkFormat color_format = lvk_swapchain.image_format();
-    create_image(lvk_swapchain.image_extent().width, lvk_swapchain.image_extent().height, 1, msaa_samples, color_format, VK_IMAGE_TILING_OPTIMAL,
-                 VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &color_image, &color_image_memory);
-    color_image_view = create_image_view(color_image, color_format, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+    // Secondary command buffers for the draws are recorded from per-worker pools, one set per swapchain image
+    command_recorder = lvk::command_recorder(device, queue_family_info.graphics_family, lvk_swapchain.size(), jobs);
+    command_recorder.set_min_items_per_worker(LAVA_MIN_DRAWS_PER_WORKER);
 }
 
-void Renderer::create_depth_resources()
+void Renderer::stream_texture()
 {
-    VkFormat depth_format = find_depth_format();
-
-    create_image(lvk_swapchain.image_extent().width, lvk_swapchain.image_extent().height, 1, msaa_samples, depth_format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &depth_image, &depth_image_memory);
-    depth_image_view = create_image_view(depth_image, depth_format, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
-
-    // We don't need to explicitly transition the depth buffer's format, as it's handled in the render pass.
-    //transition_image_layout(depth_image, depth_format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
-}
-
-void Renderer::create_texture_image()
-{
-    int width, height, channels;
-    stbi_uc * pixels = stbi_load(TEXTURE_PATH.c_str(), &width, &height, &channels, STBI_rgb_alpha);
-    VkDeviceSize image_size = width * height * STBI_rgb_alpha;
-
-    if (!pixels)
-        throw std::runtime_error("Failed to load texture image");
-
-    VkBuffer staging_buffer;
-    VkDeviceMemory staging_buffer_memory;
-
-    mip_levels = (uint32_t)std::floor(std::log2(std::max(width, height))) + 1;
-
-    create_buffer(image_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        &staging_buffer, &staging_buffer_memory);
-
-    void * data;
-    vkMapMemory(device, staging_buffer_memory, 0, image_size, 0, &data);
-    memcpy_s(data, (size_t)image_size, pixels, (size_t)image_size);
-    vkUnmapMemory(device, staging_buffer_memory);
-
-    stbi_image_free(pixels);
-
-    create_image(width, height, mip_levels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, 
-                 VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &texture_image, &texture_image_memory);
-
-    transition_image_layout(texture_image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mip_levels);
-    copy_buffer_to_image(staging_buffer, texture_image, (uint32_t)width, (uint32_t)height);
-    //transitioned to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL while generating mipmaps
-    generate_mipmaps(texture_image, VK_FORMAT_R8G8B8A8_SRGB, width, height, mip_levels);
-
-
-    vkDestroyBuffer(device, staging_buffer, nullptr);
-    vkFreeMemory(device, staging_buffer_memory, nullptr);
-}
-
-void Renderer::create_texture_image_view()
-{
-    texture_image_view = create_image_view(texture_image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, mip_levels);
+    texture = texture_streamer.stream([]()
+    {
+        int width, height, channels;
+        stbi_uc * pixels = stbi_load(TEXTURE_PATH.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+        if (!pixels)
+            throw std::runtime_error("Failed to load texture image");
+
+        lvk::texture_pixels result;
+        result.width = (uint32_t)width;
+        result.height = (uint32_t)height;
+        result.rgba.assign(pixels, pixels + width * height * STBI_rgb_alpha);
+        stbi_image_free(pixels);
+        return result;
+    });
 }
 
 void Renderer::create_texture_sampler()
@@ -490,9 +519,10 @@ void Renderer::create_texture_sampler()
     info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     info.mipLodBias = 0.0f;
     info.minLod = 0.0f;
-    info.maxLod = (float)mip_levels;
+    // Streamed views gain levels as they land, so the view alone limits the LOD range
+    info.maxLod = VK_LOD_CLAMP_NONE;
 
-    if (vkCreateSampler(device, &info, nullptr, &texture_sampler) != VK_SUCCESS)
+    if (vkCreateSampler(device, &info, lvk::host_callbacks(), &texture_sampler) != VK_SUCCESS)
         throw std::runtime_error("Failed to create sampler");
 }
 
@@ -530,70 +560,53 @@ void Renderer::load_model()
             indices.push_back(unique_vertices[v]);
         }
     }
+
+    for (uint32_t first = 0; first < indices.size(); first += LAVA_TRIANGLES_PER_DRAW * 3)
+        draw_commands.push_back({ first, std::min(LAVA_TRIANGLES_PER_DRAW * 3, (uint32_t)indices.size() - first) });
 }
 
 void Renderer::create_vertex_buffer()
 {
     VkDeviceSize buffer_size = sizeof(vertices[0]) * vertices.size();
-    VkBuffer staging_buffer;
-    VkDeviceMemory staging_buffer_memory;
-
-    create_buffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        &staging_buffer, &staging_buffer_memory);
-    void * data;
-    vkMapMemory(device, staging_buffer_memory, 0, buffer_size, 0, &data);
-    memcpy_s(data, (size_t)buffer_size, vertices.data(), (size_t)buffer_size);
-    vkUnmapMemory(device, staging_buffer_memory);
 
-    create_buffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &vertex_buffer, &vertex_buffer_memory);
+    VkBufferCreateInfo buffer_info;
+    create_buffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &vertex_buffer, &vertex_buffer_allocation, {}, &buffer_info);
 
-    copy_buffer(staging_buffer, vertex_buffer, buffer_size);
+    scene_upload = upload_engine.upload_buffer(vertex_buffer, vertices.data(), buffer_size, 0,
+                                               VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
 
-    vkDestroyBuffer(device, staging_buffer, nullptr);
-    vkFreeMemory(device, staging_buffer_memory, nullptr);
+    // The defragmenter only runs from draw_frame, by which time the constructor has waited for the upload
+    defragmenter.track_buffer(&vertex_buffer, &vertex_buffer_allocation, buffer_info, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                              VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, [this]() { geometry_version++; geometry_release_pending = true; });
 }
 
 void Renderer::create_index_buffer()
 {
     VkDeviceSize buffer_size = sizeof(indices[0]) * indices.size();
-    VkBuffer staging_buffer;
-    VkDeviceMemory staging_buffer_memory;
-
-    create_buffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        &staging_buffer, &staging_buffer_memory);
 
-    void * data;
-    vkMapMemory(device, staging_buffer_memory, 0, buffer_size, 0, &data);
-    memcpy_s(data, (size_t)buffer_size, indices.data(), (size_t)buffer_size);
-    vkUnmapMemory(device, staging_buffer_memory);
+    VkBufferCreateInfo buffer_info;
+    create_buffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &index_buffer, &index_buffer_allocation, {}, &buffer_info);
 
-    create_buffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &index_buffer, &index_buffer_memory);
-
-    copy_buffer(staging_buffer, index_buffer, buffer_size);
-
-    vkDestroyBuffer(device, staging_buffer, nullptr);
-    vkFreeMemory(device, staging_buffer_memory, nullptr);
+    // Tickets complete in order, so this one also covers the placeholder texture and the vertex buffer
+    scene_upload = upload_engine.upload_buffer(index_buffer, indices.data(), buffer_size, 0,
+                                               VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+    defragmenter.track_buffer(&index_buffer, &index_buffer_allocation, buffer_info, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                              VK_ACCESS_INDEX_READ_BIT, [this]() { geometry_version++; geometry_release_pending = true; });
 }
 
 void Renderer::create_uniform_buffers()
 {
-    VkDeviceSize buffer_size = sizeof(UniformBufferObject);
-    uniform_buffers.resize(lvk_swapchain.size());
-    uniform_buffers_memory.resize(lvk_swapchain.size());
-
-    for (size_t i = 0; i < lvk_swapchain.size(); i++)
-    {
-        create_buffer(buffer_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            &uniform_buffers[i], &uniform_buffers_memory[i]);
-    }
+    // One region per swapchain image, rewound once the image's previous frame has completed
+    uniform_ring = lvk::ring_buffer(device, lvk_physical_device, memory_allocator, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                    LAVA_FRAME_RING_REGION_SIZE, lvk_swapchain.size());
 }
 
 void Renderer::create_descriptor_pool()
 {
     std::array<VkDescriptorPoolSize, 2> sizes{};
-    sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     sizes[0].descriptorCount = lvk_swapchain.size();
     sizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     sizes[1].descriptorCount = lvk_swapchain.size();
@@ -604,7 +617,7 @@ void Renderer::create_descriptor_pool()
     info.pPoolSizes = sizes.data();
     info.maxSets = lvk_swapchain.size();
 
-    if (vkCreateDescriptorPool(device, &info, nullptr, &descriptor_pool) != VK_SUCCESS)
+    if (vkCreateDescriptorPool(device, &info, lvk::host_callbacks(), &descriptor_pool) != VK_SUCCESS)
         throw std::runtime_error("Failed to create descriptor pool");
 }
 
@@ -624,39 +637,83 @@ void Renderer::create_descriptor_sets()
     for (size_t i = 0; i < lvk_swapchain.size(); i++)
     {
         VkDescriptorBufferInfo info{};
-        info.buffer = uniform_buffers[i];
+        info.buffer = uniform_ring.vk();
         info.offset = 0;
         info.range = sizeof(UniformBufferObject);
 
-        VkDescriptorImageInfo image_info{};
-        image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        image_info.imageView = texture_image_view;
-        image_info.sampler = texture_sampler;
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = descriptor_sets[i];
+        write.dstBinding = 0;
+        write.dstArrayElement = 0;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        write.descriptorCount = 1;
+        write.pBufferInfo = &info;
 
-        std::array<VkWriteDescriptorSet, 2> writes{};
-        writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writes[0].dstSet = descriptor_sets[i];
-        writes[0].dstBinding = 0;
-        writes[0].dstArrayElement = 0;
-        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        writes[0].descriptorCount = 1;
-        writes[0].pBufferInfo = &info;
+        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+    }
+    update_texture_descriptors();
+}
 
-        writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writes[1].dstSet = descriptor_sets[i];
-        writes[1].dstBinding = 1;
-        writes[1].dstArrayElement = 0;
-        writes[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        writes[1].descriptorCount = 1;
-        writes[1].pImageInfo = &image_info;
+void Renderer::update_texture_descriptors()
+{
+    texture_descriptor_versions.resize(descriptor_sets.size());
+    for (uint32_t i = 0; i < descriptor_sets.size(); i++)
+        write_texture_descriptor(i);
+}
 
-        vkUpdateDescriptorSets(device, (uint32_t)writes.size(), writes.data(), 0, nullptr);
+void Renderer::write_texture_descriptor(uint32_t image_index)
+{
+    VkDescriptorImageInfo image_info{};
+    image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    image_info.imageView = texture_streamer.view(texture);
+    image_info.sampler = texture_sampler;
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = descriptor_sets[image_index];
+    write.dstBinding = 1;
+    write.dstArrayElement = 0;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.descriptorCount = 1;
+    write.pImageInfo = &image_info;
+
+    vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+    texture_descriptor_versions[image_index] = texture_streamer.version(texture);
+}
+
+void Renderer::refresh_image_bindings(uint32_t image_index)
+{
+    // Called once the image's previous frame has completed, so only this image's set and recordings need to change
+    bool texture_changed = texture_descriptor_versions[image_index] != texture_streamer.version(texture);
+    if (texture_changed || geometry_versions[image_index] != geometry_version)
+    {
+        if (texture_changed)
+        {
+            write_texture_descriptor(image_index);
+            // Views no set points at anymore go once the frames that may have sampled them have completed
+            uint64_t oldest = *std::min_element(texture_descriptor_versions.begin(), texture_descriptor_versions.end());
+            texture_streamer.retire_views(texture, oldest, deferred_work, graphics_timeline.last_submitted());
+        }
+        if (command_recording_mode == RecordingMode::prerecorded)
+            rerecord_command_buffer(image_index);
+        else
+            static_draw_cache.invalidate(image_index);
+        geometry_versions[image_index] = geometry_version;
+    }
+
+    // Moved geometry's old buffers can go once no image records them anymore
+    if (geometry_release_pending &&
+        std::all_of(geometry_versions.begin(), geometry_versions.end(), [this](uint64_t version) { return version == geometry_version; }))
+    {
+        defragmenter.release_replaced();
+        geometry_release_pending = false;
     }
 }
 
 void Renderer::create_command_buffers()
 {
-    command_buffers.resize(swapchain_framebuffers.size());
+    command_buffers.resize(lvk_swapchain.size());
 
     VkCommandBufferAllocateInfo alloc_info = {};
     alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -667,342 +724,776 @@ void Renderer::create_command_buffers()
     if (vkAllocateCommandBuffers(device, &alloc_info, command_buffers.data()) != VK_SUCCESS)
         throw std::runtime_error("Failed to allocate command buffers");
 
-    for (int i = 0; i < command_buffers.size(); i++)
+    // Nothing is re-recorded per frame in this mode, so dynamic draws are baked in as well
+    std::vector<DrawCommand> draws = draw_commands;
+    draws.insert(draws.end(), dynamic_draw_commands.begin(), dynamic_draw_commands.end());
+
+    geometry_versions.assign(command_buffers.size(), geometry_version);
+    for (uint32_t i = 0; i < command_buffers.size(); i++)
     {
-        VkCommandBufferBeginInfo begin_info = {};
-        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        begin_info.flags = 0;
-        begin_info.pInheritanceInfo = nullptr;
-
-        if (vkBeginCommandBuffer(command_buffers[i], &begin_info) != VK_SUCCESS)
-            throw std::runtime_error("failed to begin recording command buffer");
-
-        VkRenderPassBeginInfo render_pass_info = {};
-        render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        render_pass_info.renderPass = render_pass;
-        render_pass_info.framebuffer = swapchain_framebuffers[i];
-        render_pass_info.renderArea.offset = { 0, 0 };
-        render_pass_info.renderArea.extent = lvk_swapchain.image_extent();
-
-        std::array<VkClearValue, 3> clear_values{};
-        clear_values[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
-        clear_values[1].depthStencil = { 1.0f, 0 };
-        clear_values[2].color = { 0.0f, 0.0f, 0.0f, 1.0f };
-        render_pass_info.clearValueCount = (uint32_t)clear_values.size();
-        render_pass_info.pClearValues = clear_values.data();
-
-        vkCmdBeginRenderPass(command_buffers[i], &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
-
-        vkCmdBindPipeline(command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline);
-
-        VkBuffer vertex_buffers[] = { vertex_buffer };
-        VkDeviceSize offsets[] = { 0 };
-        vkCmdBindVertexBuffers(command_buffers[i], 0, 1, vertex_buffers, offsets);
-        vkCmdBindIndexBuffer(command_buffers[i], index_buffer, 0, VK_INDEX_TYPE_UINT32);
-
-        vkCmdBindDescriptorSets(command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1, &descriptor_sets[i], 0, nullptr);
-        vkCmdDrawIndexed(command_buffers[i], (uint32_t)indices.size(), 1, 0, 0, 0);
-        vkCmdEndRenderPass(command_buffers[i]);
-
-        if (vkEndCommandBuffer(command_buffers[i]) != VK_SUCCESS)
-            throw std::runtime_error("Failed to record command buffer");
+        command_recorder.reset(i);
+        record_frame_commands(command_buffers[i], i, command_recorder, i, draws, gpu_culling_enabled ? (uint32_t)draw_commands.size() : 0, 0, true);
     }
 }
 
-void Renderer::create_sync_objects()
+void Renderer::rerecord_command_buffer(uint32_t image_index)
 {
-    image_available_semaphores.resize(LAVA_MAX_FRAMES_IN_FLIGHT);
-    render_finished_semaphores.resize(LAVA_MAX_FRAMES_IN_FLIGHT);
-    inflight_fences.resize(LAVA_MAX_FRAMES_IN_FLIGHT);
-    inflight_images.resize(lvk_swapchain.size(), VK_NULL_HANDLE);
+    // The pool can't reset buffers one at a time, so this image's buffer is replaced
+    vkFreeCommandBuffers(device, command_pool, 1, &command_buffers[image_index]);
+
+    VkCommandBufferAllocateInfo alloc_info = {};
+    alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    alloc_info.commandPool = command_pool;
+    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.commandBufferCount = 1;
 
-    VkSemaphoreCreateInfo semaphore_info = {};
-    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    if (vkAllocateCommandBuffers(device, &alloc_info, &command_buffers[image_index]) != VK_SUCCESS)
+        throw std::runtime_error("Failed to allocate command buffers");
 
-    VkFenceCreateInfo fence_info = {};
-    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    std::vector<DrawCommand> draws = draw_commands;
+    draws.insert(draws.end(), dynamic_draw_commands.begin(), dynamic_draw_commands.end());
 
-    for (int i = 0; i < LAVA_MAX_FRAMES_IN_FLIGHT; i++)
-    {
-        if (vkCreateSemaphore(device, &semaphore_info, nullptr, &image_available_semaphores[i]) != VK_SUCCESS ||
-            vkCreateSemaphore(device, &semaphore_info, nullptr, &render_finished_semaphores[i]) != VK_SUCCESS ||
-            vkCreateFence(device, &fence_info, nullptr, &inflight_fences[i]) != VK_SUCCESS)
-            throw std::runtime_error("Failed to create semaphores");
-    }
+    command_recorder.reset(image_index);
+    record_frame_commands(command_buffers[image_index], image_index, command_recorder, image_index, draws,
+                          gpu_culling_enabled ? (uint32_t)draw_commands.size() : 0, 0, true);
 }
 
-void Renderer::destroy_swapchain()
+void Renderer::record_frame_commands(VkCommandBuffer command_buffer, uint32_t image_index, lvk::command_recorder & recorder, uint32_t recorder_frame,
+                                     const std::vector<DrawCommand> & draws, uint32_t indirect_count, VkCommandBufferUsageFlags usage, bool profile,
+                                     const std::vector<VkCommandBuffer> & cached_secondaries)
 {
-    vkDestroyImageView(device, color_image_view, nullptr);
-    vkDestroyImage(device, color_image, nullptr);
-    vkFreeMemory(device, color_image_memory, nullptr);
+    VkCommandBufferBeginInfo begin_info = {};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = usage;
+    begin_info.pInheritanceInfo = nullptr;
 
-    vkDestroyImageView(device, depth_image_view, nullptr);
-    vkDestroyImage(device, depth_image, nullptr);
-    vkFreeMemory(device, depth_image_memory, nullptr);
+    if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS)
+        throw std::runtime_error("failed to begin recording command buffer");
 
-    for (const auto framebuffer : swapchain_framebuffers)
-        vkDestroyFramebuffer(device, framebuffer, nullptr);
-    vkFreeCommandBuffers(device, command_pool, (uint32_t)command_buffers.size(), command_buffers.data());
-    vkDestroyPipeline(device, graphics_pipeline, nullptr);
-    vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
-    vkDestroyRenderPass(device, render_pass, nullptr);
-    
-    lvk_swapchain.destroy();
+    uint32_t pass_scope = 0;
+    if (profile)
+    {
+        lvk_gpu_profiler.begin_frame(command_buffer, image_index);
+        pass_scope = lvk_gpu_profiler.begin_scope(command_buffer, image_index, "main pass");
+    }
 
-    for (size_t i = 0; i < lvk_swapchain.size(); i++)
+    render_graph.record(command_buffer, image_index, [&](VkCommandBuffer pass_command_buffer, const lvk::render_graph_pass_info & info)
+    {
+        if (info.pass != forward_pass)
+            return;
+
+        VkCommandBufferInheritanceInfo inheritance = {};
+        inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritance.renderPass = info.render_pass;
+        inheritance.subpass = 0;
+        inheritance.framebuffer = info.framebuffer;
+
+        std::vector<VkCommandBuffer> recorded = recorder.record(recorder_frame, inheritance, (uint32_t)draws.size(),
+            [this, image_index, &draws, indirect_count, profile](VkCommandBuffer secondary, uint32_t, uint32_t first, uint32_t last)
+            {
+                record_draws(secondary, image_index, draws, indirect_count, first, last, profile);
+            },
+            usage);
+        std::vector<VkCommandBuffer> secondaries = cached_secondaries;
+        secondaries.insert(secondaries.end(), recorded.begin(), recorded.end());
+
+        if (!secondaries.empty())
+            vkCmdExecuteCommands(pass_command_buffer, (uint32_t)secondaries.size(), secondaries.data());
+    });
+    if (profile)
+        lvk_gpu_profiler.end_scope(command_buffer, image_index, pass_scope);
+
+    if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+        throw std::runtime_error("Failed to record command buffer");
+}
+
+void Renderer::record_draws(VkCommandBuffer command_buffer, uint32_t image_index, const std::vector<DrawCommand> & draws, uint32_t indirect_count,
+                            uint32_t first, uint32_t last, bool profile)
+{
+    // Secondary command buffers inherit no state, so every worker binds everything it uses
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline);
+
+    VkBuffer vertex_buffers[] = { vertex_buffer };
+    VkDeviceSize offsets[] = { 0 };
+    vkCmdBindVertexBuffers(command_buffer, 0, 1, vertex_buffers, offsets);
+    vkCmdBindIndexBuffer(command_buffer, index_buffer, 0, VK_INDEX_TYPE_UINT32);
+
+    // The frame constants are the first allocation in the image's ring region, so pre-recorded buffers stay valid
+    uint32_t uniform_offset = (uint32_t)uniform_ring.region_offset(image_index);
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1, &descriptor_sets[image_index], 1, &uniform_offset);
+
+    // Whatever the pass costs beyond the geometry scopes is mostly the clear and the MSAA resolve
+    uint32_t geometry_scope = 0;
+    if (profile)
+        geometry_scope = lvk_gpu_profiler.begin_scope(command_buffer, image_index, "geometry", VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT);
+    // The first indirect_count draws are the static ones, whose commands the culling shader writes each frame
+    uint32_t indirect_end = std::min(last, indirect_count);
+    if (first < indirect_end)
     {
-        vkDestroyBuffer(device, uniform_buffers[i], nullptr);
-        vkFreeMemory(device, uniform_buffers_memory[i], nullptr);
+        VkDeviceSize stride = sizeof(VkDrawIndexedIndirectCommand);
+        if (multi_draw_indirect)
+            vkCmdDrawIndexedIndirect(command_buffer, indirect_buffers[image_index], first * stride, indirect_end - first, (uint32_t)stride);
+        else
+            for (uint32_t d = first; d < indirect_end; d++)
+                vkCmdDrawIndexedIndirect(command_buffer, indirect_buffers[image_index], d * stride, 1, (uint32_t)stride);
     }
+    for (uint32_t d = std::max(first, indirect_end); d < last; d++)
+        vkCmdDrawIndexed(command_buffer, draws[d].index_count, 1, draws[d].first_index, 0, 0);
+    if (profile)
+        lvk_gpu_profiler.end_scope(command_buffer, image_index, geometry_scope, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+}
 
-    vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
+VkCommandBuffer Renderer::record_frame(uint32_t slot_index, uint32_t image_index)
+{
+    // The slot's previous submission has completed, so its transient pools are reset in one call each
+    frame_recorder.reset(slot_index);
+    VkCommandBuffer command_buffer = frame_recorder.acquire_primary(slot_index);
+
+    // Static draws are replayed from a cached secondary until anything they were recorded against changes.
+    // The image's last submission has completed, so a stale entry can be recorded again in place.
+    VkCommandBufferInheritanceInfo inheritance = {};
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance.renderPass = render_pass;
+    inheritance.subpass = 0;
+    inheritance.framebuffer = render_graph.framebuffer(forward_pass, image_index);
+
+    lvk::command_cache_key key = lvk::command_cache_key()
+        .input(render_pass)
+        .input(inheritance.framebuffer)
+        .input(graphics_pipeline)
+        .input(pipeline_layout)
+        .input(vertex_buffer)
+        .input(index_buffer)
+        .input(descriptor_sets[image_index])
+        .input(uniform_ring.vk())
+        .input(gpu_culling_enabled ? indirect_buffers[image_index] : VK_NULL_HANDLE)
+        .input(static_draws_version);
+    VkCommandBuffer static_commands = static_draw_cache.get(image_index, key, inheritance,
+        [this, image_index](VkCommandBuffer secondary)
+        {
+            uint32_t static_count = (uint32_t)draw_commands.size();
+            record_draws(secondary, image_index, draw_commands, gpu_culling_enabled ? static_count : 0, 0, static_count, false);
+        });
+
+    record_frame_commands(command_buffer, image_index, frame_recorder, slot_index, dynamic_draw_commands, 0, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, true, { static_commands });
+    return command_buffer;
 }
 
-void Renderer::recreate_swapchain()
+void Renderer::set_static_draws(const std::vector<DrawCommand> & draws)
 {
-    lvk::DeviceSurfaceDetails surface_details = lvk::query_surface_details(lvk_physical_device.vk(), window_surface);
-    if (surface_details.capabilities.currentExtent.width == 0 || surface_details.capabilities.currentExtent.height == 0)
+    // Bounds and indirect buffers are sized by the list, so nothing may still be reading them
+    frame_scheduler.wait_all();
+    compute_timeline.wait(compute_timeline.last_submitted());
+
+    draw_commands = draws;
+    static_draws_version++;
+
+    destroy_cull_resources();
+    vkDestroyBuffer(device, draw_bounds_buffer, lvk::host_callbacks());
+    memory_allocator.free(draw_bounds_allocation);
+    create_draw_bounds_buffer();
+    create_cull_resources();
+
+    // Pre-recorded buffers can only pick the change up by recording every image again
+    if (command_recording_mode == RecordingMode::prerecorded)
+        rerecord_command_buffers();
+}
+
+void Renderer::set_gpu_culling(bool enabled)
+{
+    if (enabled == gpu_culling_enabled)
         return;
 
-    vkDeviceWaitIdle(device);
+    frame_scheduler.wait_all();
+    gpu_culling_enabled = enabled;
+    if (command_recording_mode == RecordingMode::prerecorded)
+        rerecord_command_buffers();
+}
 
-    destroy_swapchain();
+void Renderer::rerecord_command_buffers()
+{
+    vkFreeCommandBuffers(device, command_pool, (uint32_t)command_buffers.size(), command_buffers.data());
+    create_command_buffers();
+}
 
-    int draw_width = 0, draw_height = 0;
-    SDL_Vulkan_GetDrawableSize(sdl_window, &draw_width, &draw_height);
+void Renderer::set_recording_mode(RecordingMode mode)
+{
+    if (mode == command_recording_mode)
+        return;
 
-    lvk_swapchain = lvk::swapchain_builder(lvk_device, lvk_physical_device)
-        .size((uint32_t)draw_width, (uint32_t)draw_height)
-        .image_usage(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)
-        .composite_alpha(VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR)
-        .clipped(VK_TRUE)
-        .graphics_family_index(graphics_queue_family_index)
-        .present_family_index(present_queue_family_index)
-        .build();
-    swapchain = lvk_swapchain.vk();
+    frame_scheduler.wait_all();
+    if (mode == RecordingMode::per_frame)
+    {
+        frame_recorder = lvk::command_recorder(device, graphics_queue_family_index, frames_in_flight(), jobs, 0, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+        frame_recorder.set_min_items_per_worker(LAVA_MIN_DRAWS_PER_WORKER);
+        static_draw_cache = lvk::command_cache(device, graphics_queue_family_index, lvk_swapchain.size());
+        geometry_versions.assign(lvk_swapchain.size(), geometry_version);
+    }
+    else
+    {
+        // The pre-recorded buffers still carry the last timestamp queries, so record them again
+        frame_recorder.destroy();
+        static_draw_cache.destroy();
+        rerecord_command_buffers();
+    }
+    command_recording_mode = mode;
+}
 
-    create_render_pass();
-    create_graphics_pipeline();
-    create_color_resources();
-    create_depth_resources();
-    create_framebuffers();
-    create_uniform_buffers();
-    create_descriptor_pool();
-    create_descriptor_sets();
-    create_command_buffers();
+std::vector<RecordingBenchmarkResult> Renderer::benchmark_recording(uint32_t draw_count, uint32_t iterations)
+{
+    // The benchmark draws are copies of the scene's, so there has to be at least one
+    if (draw_commands.empty())
+        throw std::runtime_error("Recording benchmark needs a scene with at least one draw");
+
+    std::vector<DrawCommand> draws(draw_count);
+    for (uint32_t i = 0; i < draw_count; i++)
+        draws[i] = draw_commands[i % draw_commands.size()];
+
+    std::vector<RecordingBenchmarkResult> results;
+    uint32_t max_workers = std::min(std::max(std::thread::hardware_concurrency(), 1u), 8u);
+    for (uint32_t workers = 1; ; workers = std::min(workers * 2, max_workers))
+    {
+        // Nothing is submitted, so the recorded buffers may reference image 0's framebuffer freely
+        lvk::job_system benchmark_jobs(workers);
+        lvk::command_recorder recorder(device, graphics_queue_family_index, 1, benchmark_jobs, workers, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+        recorder.set_min_items_per_worker(LAVA_MIN_DRAWS_PER_WORKER);
+
+        auto record_once = [&]()
+        {
+            recorder.reset(0);
+            record_frame_commands(recorder.acquire_primary(0), 0, recorder, 0, draws, 0, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, false);
+        };
+
+        // The first pass allocates the command buffers, which a running renderer only pays once
+        record_once();
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++)
+            record_once();
+        double total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        recorder.destroy();
+
+        RecordingBenchmarkResult result;
+        result.workers = workers;
+        result.draws = draw_count;
+        result.ms_per_frame = total_ms / std::max(iterations, 1u);
+        result.ns_per_draw = result.ms_per_frame * 1000000.0 / std::max(draw_count, 1u);
+        results.push_back(result);
+
+        if (workers == max_workers)
+            break;
+    }
+    return results;
 }
 
-void Renderer::handle_window_resize()
+std::vector<JobBenchmarkResult> Renderer::benchmark_jobs(uint32_t draw_count, uint32_t iterations)
 {
-    window_resized = true;
+    if (draw_commands.empty())
+        throw std::runtime_error("Job benchmark needs a scene with at least one draw");
+
+    std::vector<DrawCommand> draws(draw_count);
+    for (uint32_t i = 0; i < draw_count; i++)
+        draws[i] = draw_commands[i % draw_commands.size()];
+
+    std::vector<JobBenchmarkResult> results;
+    uint32_t max_workers = std::max(std::thread::hardware_concurrency(), 1u);
+    for (uint32_t workers = 1; ; workers = std::min(workers * 2, max_workers))
+    {
+        lvk::job_system system(workers);
+
+        // Bounds over the whole draw list is the CPU side of culling and scales with the draw count
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++)
+            compute_draw_bounds(system, draws);
+        double total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        JobBenchmarkResult result;
+        result.workers = workers;
+        result.draws = draw_count;
+        result.ms_per_iteration = total_ms / std::max(iterations, 1u);
+        result.speedup = results.empty() ? 1.0 : results.front().ms_per_iteration / result.ms_per_iteration;
+        results.push_back(result);
+
+        if (workers == max_workers)
+            break;
+    }
+    return results;
 }
 
-void Renderer::create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer * buffer, VkDeviceMemory * memory)
+std::vector<MipmapBenchmarkResult> Renderer::benchmark_mipmaps(uint32_t size, uint32_t iterations)
 {
-    VkBufferCreateInfo info{};
-    info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    info.size = size;
-    info.usage = usage;
+    VkImageCreateInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    info.flags = lvk::mip_generator::compute_flags(VK_FORMAT_R8G8B8A8_SRGB);
+    info.imageType = VK_IMAGE_TYPE_2D;
+    info.format = VK_FORMAT_R8G8B8A8_SRGB;
+    info.extent = { size, size, 1 };
+    info.mipLevels = (uint32_t)std::floor(std::log2(std::max(size, 1u))) + 1;
+    info.arrayLayers = 1;
+    info.samples = VK_SAMPLE_COUNT_1_BIT;
+    info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    info.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | lvk::mip_generator::compute_usage();
     info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
-    if (vkCreateBuffer(device, &info, nullptr, buffer) != VK_SUCCESS)
-        throw std::runtime_error("Failed to create buffer");
+    VkImage image;
+    if (vkCreateImage(device, &info, lvk::host_callbacks(), &image) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create mipmap benchmark image");
+    lvk::allocation memory = memory_allocator.allocate_image(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    lvk::gpu_profiler profiler(device, lvk_physical_device, graphics_queue_family_index, 1);
+    lvk::mip_chain chain = { image, info.format, info.usage, info.flags, size, size, info.mipLevels,
+                             VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT };
 
-    VkMemoryRequirements mem_info;
-    vkGetBufferMemoryRequirements(device, *buffer, &mem_info);
+    std::vector<MipmapBenchmarkResult> results;
+    for (lvk::mip_generation_path path : { lvk::mip_generation_path::compute, lvk::mip_generation_path::blit })
+    {
+        if (!mip_generator.supports(chain, path))
+            continue;
+        mip_generator.set_preferred_path(path);
 
-    VkMemoryAllocateInfo alloc_info{};
-    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    alloc_info.allocationSize = mem_info.size;
-    alloc_info.memoryTypeIndex = lvk::find_memory_type(mem_info.memoryTypeBits, properties, lvk_physical_device.vk());
+        double gpu_ms = 0.0;
+        double record_ms = 0.0;
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+            VkCommandBufferAllocateInfo alloc_info = {};
+            alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            alloc_info.commandPool = command_pool;
+            alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            alloc_info.commandBufferCount = 1;
+
+            VkCommandBuffer command_buffer;
+            if (vkAllocateCommandBuffers(device, &alloc_info, &command_buffer) != VK_SUCCESS)
+                throw std::runtime_error("Failed to allocate mipmap benchmark command buffer");
+
+            VkCommandBufferBeginInfo begin_info = {};
+            begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            vkBeginCommandBuffer(command_buffer, &begin_info);
+            profiler.begin_frame(command_buffer, 0);
+
+            // Level 0 is cleared instead of uploaded, only the generation itself is measured
+            VkImageMemoryBarrier barrier = {};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = image;
+            barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, info.mipLevels, 0, 1 };
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+            VkClearColorValue color = { { 0.25f, 0.5f, 0.75f, 1.0f } };
+            VkImageSubresourceRange level_zero = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+            vkCmdClearColorImage(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &color, 1, &level_zero);
+
+            auto record_start = std::chrono::steady_clock::now();
+            uint32_t scope = profiler.begin_scope(command_buffer, 0, "mipmaps", VK_PIPELINE_STAGE_TRANSFER_BIT);
+            mip_generator.record(command_buffer, { chain },
+                                 { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL });
+            profiler.end_scope(command_buffer, 0, scope);
+            record_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - record_start).count();
+
+            if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+                throw std::runtime_error("Failed to record mipmap benchmark command buffer");
+
+            uint64_t value = graphics_timeline.next();
+            if (lvk::timeline_submit().command_buffer(command_buffer).signal(graphics_timeline, value).submit(graphics_queue) != VK_SUCCESS)
+                throw std::runtime_error("Failed to submit mipmap benchmark command buffer");
+            profiler.mark_submitted(0);
+            graphics_timeline.wait(value);
+
+            if (profiler.collect(0))
+                gpu_ms += profiler.latest_timings(0).front().milliseconds();
+            vkFreeCommandBuffers(device, command_pool, 1, &command_buffer);
+            mip_generator.retire(value);
+            mip_generator.collect(value);
+        }
 
-    if (vkAllocateMemory(device, &alloc_info, nullptr, memory) != VK_SUCCESS)
-        throw std::runtime_error("Failed to allocate buffer memory");
+        MipmapBenchmarkResult result;
+        result.path = path;
+        result.size = size;
+        result.mip_levels = info.mipLevels;
+        result.gpu_ms = gpu_ms / std::max(iterations, 1u);
+        result.record_ms = record_ms / std::max(iterations, 1u);
+        results.push_back(result);
+    }
+    mip_generator.set_preferred_path(lvk::mip_generation_path::compute);
 
-    vkBindBufferMemory(device, *buffer, *memory, 0);
+    profiler.destroy();
+    vkDestroyImage(device, image, lvk::host_callbacks());
+    memory_allocator.free(memory);
+    return results;
 }
 
-void Renderer::copy_buffer(VkBuffer src, VkBuffer dst, VkDeviceSize size)
+void Renderer::create_sync_objects()
 {
-    VkCommandBuffer command_buffer = begin_single_time_commands();
-    VkBufferCopy region{};
-    region.size = size;
-    vkCmdCopyBuffer(command_buffer, src, dst, 1, &region);
-    end_single_time_commands(command_buffer);
+    frame_scheduler = lvk::frame_scheduler(device, graphics_timeline, lvk_swapchain.recommended_frames_in_flight(), lvk_swapchain.size());
 }
 
-void Renderer::transition_image_layout(VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, uint32_t mip_levels)
+void Renderer::create_cull_pipeline()
 {
-    VkCommandBuffer command_buffer = begin_single_time_commands();
+    cull_descriptor_set_layout = lvk::descriptor_set_layout_builder()
+        .layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, 1, VK_SHADER_STAGE_COMPUTE_BIT)
+        .layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, 1, VK_SHADER_STAGE_COMPUTE_BIT)
+        .build(lvk_device);
 
-    VkImageMemoryBarrier barrier{};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = old_layout;
-    barrier.newLayout = new_layout;
+    VkDescriptorSetLayout set_layout = cull_descriptor_set_layout.vk();
 
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    VkPushConstantRange push_constants = {};
+    push_constants.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constants.offset = 0;
+    push_constants.size = sizeof(CullParameters);
 
-    barrier.image = image;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = mip_levels;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
+    VkPipelineLayoutCreateInfo layout_info = {};
+    layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layout_info.setLayoutCount = 1;
+    layout_info.pSetLayouts = &set_layout;
+    layout_info.pushConstantRangeCount = 1;
+    layout_info.pPushConstantRanges = &push_constants;
 
-    VkPipelineStageFlags src_stage;
-    VkPipelineStageFlags dst_stage;
+    if (vkCreatePipelineLayout(device, &layout_info, lvk::host_callbacks(), &cull_pipeline_layout) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create culling pipeline layout");
 
-    if (new_layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
-    {
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-        if (HAS_STENCIL_COMPONENT(format))
-            barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
-    }
-    else
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    auto cull_shader_source = load_file("shaders/cull.spv");
+    VkShaderModule cull_shader = lvk::create_shader_module(device, cull_shader_source);
 
-    if (old_layout == VK_IMAGE_LAYOUT_UNDEFINED && new_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
-    {
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    VkComputePipelineCreateInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    info.stage.module = cull_shader;
+    info.stage.pName = "main";
+    info.layout = cull_pipeline_layout;
 
-        src_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        dst_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    }
-    else if (old_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && new_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+    if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &info, lvk::host_callbacks(), &cull_pipeline) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create culling pipeline");
+
+    vkDestroyShaderModule(device, cull_shader, lvk::host_callbacks());
+
+    VkCommandPoolCreateInfo pool_info = {};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.queueFamilyIndex = compute_queue.family_index;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+    if (vkCreateCommandPool(device, &pool_info, lvk::host_callbacks(), &compute_command_pool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create compute command pool");
+}
+
+std::vector<DrawBounds> Renderer::compute_draw_bounds(lvk::job_system & system, const std::vector<DrawCommand> & draws) const
+{
+    std::vector<DrawBounds> bounds(draws.size());
+    system.parallel_for((uint32_t)draws.size(), LAVA_BOUNDS_PER_JOB, [&](uint32_t first, uint32_t last)
     {
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        for (uint32_t d = first; d < last; d++)
+        {
+            glm::vec3 min_corner(std::numeric_limits<float>::max());
+            glm::vec3 max_corner(-std::numeric_limits<float>::max());
+            for (uint32_t i = 0; i < draws[d].index_count; i++)
+            {
+                const glm::vec3 & position = vertices[indices[draws[d].first_index + i]].position;
+                min_corner = glm::min(min_corner, position);
+                max_corner = glm::max(max_corner, position);
+            }
 
-        src_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        dst_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    }
-    else if (old_layout == VK_IMAGE_LAYOUT_UNDEFINED && new_layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
+            glm::vec3 center = (min_corner + max_corner) * 0.5f;
+            float radius = 0.0f;
+            for (uint32_t i = 0; i < draws[d].index_count; i++)
+                radius = std::max(radius, glm::distance(center, vertices[indices[draws[d].first_index + i]].position));
+
+            bounds[d].sphere = glm::vec4(center, radius);
+            bounds[d].first_index = draws[d].first_index;
+            bounds[d].index_count = draws[d].index_count;
+        }
+    });
+    return bounds;
+}
+
+void Renderer::create_draw_bounds_buffer()
+{
+    std::vector<DrawBounds> bounds = compute_draw_bounds(jobs, draw_commands);
+    if (bounds.empty())
+        bounds.resize(1);
+
+    // Small and written once, so it lives in host visible memory shared by both queues
+    VkDeviceSize size = sizeof(DrawBounds) * bounds.size();
+    create_buffer(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                  &draw_bounds_buffer, &draw_bounds_allocation, { graphics_queue_family_index, compute_queue.family_index });
+
+    memcpy_s(draw_bounds_allocation.mapped, (size_t)size, bounds.data(), (size_t)size);
+}
+
+void Renderer::create_cull_resources()
+{
+    uint32_t image_count = lvk_swapchain.size();
+    VkDeviceSize indirect_size = sizeof(VkDrawIndexedIndirectCommand) * std::max<size_t>(draw_commands.size(), 1);
+
+    // Concurrent sharing avoids an ownership transfer of every indirect buffer every frame
+    indirect_buffers.resize(image_count);
+    indirect_buffers_allocations.resize(image_count);
+    for (uint32_t i = 0; i < image_count; i++)
+        create_buffer(indirect_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                      &indirect_buffers[i], &indirect_buffers_allocations[i], { graphics_queue_family_index, compute_queue.family_index });
+
+    VkDescriptorPoolSize pool_size = {};
+    pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    pool_size.descriptorCount = image_count * 2;
+
+    VkDescriptorPoolCreateInfo pool_info = {};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.poolSizeCount = 1;
+    pool_info.pPoolSizes = &pool_size;
+    pool_info.maxSets = image_count;
+
+    if (vkCreateDescriptorPool(device, &pool_info, lvk::host_callbacks(), &cull_descriptor_pool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create culling descriptor pool");
+
+    std::vector<VkDescriptorSetLayout> layouts(image_count, cull_descriptor_set_layout.vk());
+    VkDescriptorSetAllocateInfo alloc_info = {};
+    alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    alloc_info.descriptorPool = cull_descriptor_pool;
+    alloc_info.descriptorSetCount = image_count;
+    alloc_info.pSetLayouts = layouts.data();
+
+    cull_descriptor_sets.resize(image_count);
+    if (vkAllocateDescriptorSets(device, &alloc_info, cull_descriptor_sets.data()) != VK_SUCCESS)
+        throw std::runtime_error("Failed to allocate culling descriptor sets");
+
+    for (uint32_t i = 0; i < image_count; i++)
     {
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        VkDescriptorBufferInfo bounds_info = {};
+        bounds_info.buffer = draw_bounds_buffer;
+        bounds_info.offset = 0;
+        bounds_info.range = VK_WHOLE_SIZE;
+
+        VkDescriptorBufferInfo commands_info = {};
+        commands_info.buffer = indirect_buffers[i];
+        commands_info.offset = 0;
+        commands_info.range = VK_WHOLE_SIZE;
 
-        src_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        dst_stage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        std::array<VkWriteDescriptorSet, 2> writes{};
+        writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[0].dstSet = cull_descriptor_sets[i];
+        writes[0].dstBinding = 0;
+        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[0].descriptorCount = 1;
+        writes[0].pBufferInfo = &bounds_info;
+
+        writes[1] = writes[0];
+        writes[1].dstBinding = 1;
+        writes[1].pBufferInfo = &commands_info;
+
+        vkUpdateDescriptorSets(device, (uint32_t)writes.size(), writes.data(), 0, nullptr);
     }
-    else throw std::invalid_argument("unsupported layout transition");
 
-    vkCmdPipelineBarrier(command_buffer, src_stage, dst_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    compute_command_buffers.resize(image_count);
+    VkCommandBufferAllocateInfo command_info = {};
+    command_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    command_info.commandPool = compute_command_pool;
+    command_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    command_info.commandBufferCount = image_count;
 
-    end_single_time_commands(command_buffer);
+    if (vkAllocateCommandBuffers(device, &command_info, compute_command_buffers.data()) != VK_SUCCESS)
+        throw std::runtime_error("Failed to allocate compute command buffers");
 }
 
-void Renderer::copy_buffer_to_image(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
+void Renderer::destroy_cull_resources()
 {
-    VkCommandBuffer command_buffer = begin_single_time_commands();
+    vkFreeCommandBuffers(device, compute_command_pool, (uint32_t)compute_command_buffers.size(), compute_command_buffers.data());
+    vkDestroyDescriptorPool(device, cull_descriptor_pool, lvk::host_callbacks());
+    for (size_t i = 0; i < indirect_buffers.size(); i++)
+    {
+        vkDestroyBuffer(device, indirect_buffers[i], lvk::host_callbacks());
+        memory_allocator.free(indirect_buffers_allocations[i]);
+    }
+}
 
-    VkBufferImageCopy region{};
-    region.bufferOffset = 0;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
+uint64_t Renderer::dispatch_culling(uint32_t image_index, const UniformBufferObject & ubo)
+{
+    // Gribb/Hartmann planes of the full transform are in model space, where the bounds are
+    glm::mat4 m = ubo.proj * ubo.view * ubo.transform;
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    CullParameters parameters = {};
+    parameters.planes[0] = row3 + row0;
+    parameters.planes[1] = row3 - row0;
+    parameters.planes[2] = row3 + row1;
+    parameters.planes[3] = row3 - row1;
+    parameters.planes[4] = row2;
+    parameters.planes[5] = row3 - row2;
+    for (auto & plane : parameters.planes)
+        plane /= glm::length(glm::vec3(plane));
+    parameters.draw_count = (uint32_t)draw_commands.size();
+
+    // The graphics submission that read this image's commands last waited on the previous dispatch, so both are done
+    VkCommandBuffer command_buffer = compute_command_buffers[image_index];
+    VkCommandBufferBeginInfo begin_info = {};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
+    if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS)
+        throw std::runtime_error("Failed to begin culling command buffer");
 
-    region.imageOffset = { 0, 0, 0 };
-    region.imageExtent = { width, height, 1 };
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, cull_pipeline);
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, cull_pipeline_layout, 0, 1, &cull_descriptor_sets[image_index], 0, nullptr);
+    vkCmdPushConstants(command_buffer, cull_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullParameters), &parameters);
+    vkCmdDispatch(command_buffer, (parameters.draw_count + 63) / 64, 1, 1);
 
-    vkCmdCopyBufferToImage(command_buffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+        throw std::runtime_error("Failed to record culling command buffer");
 
-    end_single_time_commands(command_buffer);
+    uint64_t value = compute_timeline.next();
+    if (lvk::timeline_submit().command_buffer(command_buffer).signal(compute_timeline, value).submit(compute_queue.vk_queue) != VK_SUCCESS)
+        throw std::runtime_error("Failed to submit culling");
+    return value;
 }
 
-void Renderer::create_image(uint32_t width, uint32_t height, uint32_t mip_levels, VkSampleCountFlagBits sample_count, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage * image, VkDeviceMemory * memory)
+void Renderer::create_gpu_profiler()
 {
-    VkImageCreateInfo info{};
-    info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    info.imageType = VK_IMAGE_TYPE_2D;
-    info.extent.width = (uint32_t)width;
-    info.extent.height = (uint32_t)height;
-    info.extent.depth = 1;
-    info.mipLevels = mip_levels;
-    info.arrayLayers = 1;
-    info.format = format;
-    info.tiling = tiling;
-    info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    info.usage = usage;
-    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    info.samples = sample_count;
+    // One profiler frame per pre-recorded command buffer
+    lvk_gpu_profiler = lvk::gpu_profiler(device, lvk_physical_device, graphics_queue_family_index, lvk_swapchain.size());
+    name_gpu_profiler_frames();
+}
 
-    if (vkCreateImage(device, &info, nullptr, image) != VK_SUCCESS)
-        throw std::runtime_error("Failed to create image!");
+void Renderer::name_gpu_profiler_frames()
+{
+    for (uint32_t i = 0; i < lvk_gpu_profiler.frame_count(); i++)
+        lvk_gpu_profiler.name_frame(i, "swapchain image " + std::to_string(i));
+}
 
-    VkMemoryRequirements mrequirements;
-    vkGetImageMemoryRequirements(device, *image, &mrequirements);
+void Renderer::create_swapchain()
+{
+    int draw_width = 0, draw_height = 0;
+    SDL_Vulkan_GetDrawableSize(sdl_window, &draw_width, &draw_height);
 
-    VkMemoryAllocateInfo alloc_info{};
-    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    alloc_info.allocationSize = mrequirements.size;
-    alloc_info.memoryTypeIndex = lvk::find_memory_type(mrequirements.memoryTypeBits, properties, lvk_physical_device.vk());
+    lvk::swapchain old_swapchain = lvk_swapchain;
+    lvk_swapchain = lvk::swapchain_builder(lvk_device, lvk_physical_device)
+        .size((uint32_t)draw_width, (uint32_t)draw_height)
+        .image_usage(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)
+        .composite_alpha(VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR)
+        .clipped(VK_TRUE)
+        .graphics_family_index(graphics_queue_family_index)
+        .present_family_index(present_queue_family_index)
+        .present_policy(present_policy)
+        .old_swapchain(old_swapchain.vk())
+        .build();
+    swapchain = lvk_swapchain.vk();
+
+    if (old_swapchain.vk() != VK_NULL_HANDLE)
+        old_swapchain.destroy();
+}
+
+void Renderer::destroy_swapchain_image_resources()
+{
+    render_graph.destroy_resources();
+    vkFreeCommandBuffers(device, command_pool, (uint32_t)command_buffers.size(), command_buffers.data());
 
-    if (vkAllocateMemory(device, &alloc_info, nullptr, memory) != VK_SUCCESS)
-        throw std::runtime_error("Failed to allocate image memory");
+    uniform_ring.destroy();
 
-    vkBindImageMemory(device, *image, *memory, 0);
+    vkDestroyDescriptorPool(device, descriptor_pool, lvk::host_callbacks());
+    destroy_cull_resources();
 }
 
-VkCommandBuffer Renderer::begin_single_time_commands()
+void Renderer::create_swapchain_image_resources()
 {
-    VkCommandBufferAllocateInfo info{};
-    info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    info.commandPool = command_pool;
-    info.commandBufferCount = 1;
+    lvk_gpu_profiler.resize(lvk_swapchain.size());
+    name_gpu_profiler_frames();
+    command_recorder.resize(lvk_swapchain.size());
+    if (command_recording_mode == RecordingMode::per_frame)
+        static_draw_cache.resize(lvk_swapchain.size());
 
-    VkCommandBuffer command_buffer;
-    vkAllocateCommandBuffers(device, &info, &command_buffer);
+    create_render_graph_resources();
+    create_uniform_buffers();
+    create_descriptor_pool();
+    create_descriptor_sets();
+    create_cull_resources();
+    create_command_buffers();
 
-    VkCommandBufferBeginInfo begin_info{};
-    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    frame_scheduler.set_image_count(lvk_swapchain.size());
+}
 
-    vkBeginCommandBuffer(command_buffer, &begin_info);
+void Renderer::destroy_swapchain()
+{
+    destroy_swapchain_image_resources();
 
-    return command_buffer;
+    vkDestroyPipeline(device, graphics_pipeline, lvk::host_callbacks());
+    vkDestroyPipelineLayout(device, pipeline_layout, lvk::host_callbacks());
+}
+
+void Renderer::recreate_swapchain()
+{
+    lvk::DeviceSurfaceDetails surface_details = lvk::query_surface_details(lvk_physical_device.vk(), window_surface);
+    if (surface_details.capabilities.currentExtent.width == 0 || surface_details.capabilities.currentExtent.height == 0)
+        return;
+
+    vkDeviceWaitIdle(device);
+
+    // The render passes only depend on the surface format, so they survive a resize; the graph's images don't
+    destroy_swapchain();
+    create_swapchain();
+
+    create_graphics_pipeline();
+    create_swapchain_image_resources();
 }
 
-void Renderer::end_single_time_commands(VkCommandBuffer command_buffer)
+void Renderer::set_present_policy(lvk::present_policy policy)
 {
-    vkEndCommandBuffer(command_buffer);
+    present_policy = policy;
+    vkDeviceWaitIdle(device);
 
-    VkSubmitInfo info{};
-    info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    info.commandBufferCount = 1;
-    info.pCommandBuffers = &command_buffer;
+    // Extent and format are unchanged, so the render passes and pipeline are kept
+    destroy_swapchain_image_resources();
+    create_swapchain();
+    create_swapchain_image_resources();
 
-    vkQueueSubmit(graphics_queue, 1, &info, VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphics_queue);
+    set_frames_in_flight(lvk_swapchain.recommended_frames_in_flight());
+}
 
-    vkFreeCommandBuffers(device, command_pool, 1, &command_buffer);
+void Renderer::handle_window_resize()
+{
+    window_resized = true;
+}
+
+void Renderer::set_frames_in_flight(uint32_t count)
+{
+    frame_scheduler.set_frames_in_flight(count);
+
+    // A changed slot count has already waited for every slot, so the old pools are idle
+    if (command_recording_mode == RecordingMode::per_frame && frame_recorder.frame_count() != frames_in_flight())
+        frame_recorder.resize(frames_in_flight());
 }
 
-VkImageView Renderer::create_image_view(VkImage image, VkFormat format, VkImageAspectFlags aspect_flags, uint32_t mip_levels)
+void Renderer::create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer * buffer, lvk::allocation * allocation,
+                             const std::vector<uint32_t> & queue_families, VkBufferCreateInfo * created_info)
 {
-    VkImageViewCreateInfo info{};
-    info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    info.image = image;
-    info.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    info.format = format;
-    info.subresourceRange.aspectMask = aspect_flags;
-    info.subresourceRange.baseMipLevel = 0;
-    info.subresourceRange.levelCount = mip_levels;
-    info.subresourceRange.baseArrayLayer = 0;
-    info.subresourceRange.layerCount = 1;
-
-    VkImageView image_view;
-    if (vkCreateImageView(device, &info, nullptr, &image_view) != VK_SUCCESS)
-        throw std::runtime_error("Failed to create image view");
-
-    return image_view;
+    std::set<uint32_t> unique_families(queue_families.begin(), queue_families.end());
+    std::vector<uint32_t> sharing_families(unique_families.begin(), unique_families.end());
+
+    VkBufferCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    info.size = size;
+    info.usage = usage;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (sharing_families.size() > 1)
+    {
+        info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        info.queueFamilyIndexCount = (uint32_t)sharing_families.size();
+        info.pQueueFamilyIndices = sharing_families.data();
+    }
+
+    if (vkCreateBuffer(device, &info, lvk::host_callbacks(), buffer) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create buffer");
+
+    *allocation = memory_allocator.allocate_buffer(*buffer, properties);
+    if (created_info)
+    {
+        *created_info = info;
+        created_info->pQueueFamilyIndices = nullptr;
+    }
 }
 
 VkFormat Renderer::find_supported_format(const std::vector<VkFormat> & candidates, VkImageTiling tiling, VkFormatFeatureFlags features)
@@ -1027,87 +1518,19 @@ VkFormat Renderer::find_depth_format()
                                  VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
 }
 
-void Renderer::generate_mipmaps(VkImage image, VkFormat format, int32_t width, int32_t height, uint32_t mip_levels)
-{
-    VkFormatProperties properties;
-    vkGetPhysicalDeviceFormatProperties(lvk_physical_device.vk(), format, &properties);
-
-    if (!(properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
-        throw std::runtime_error("texture image format does not support linear blitting");
-
-    VkCommandBuffer command_buffer = begin_single_time_commands();
-
-    VkImageMemoryBarrier barrier{};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.image = image;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-    barrier.subresourceRange.levelCount = 1;
-
-    int32_t mip_width = width;
-    int32_t mip_height = height;
-
-    for (uint32_t i = 1; i < mip_levels; i++)
-    {
-        barrier.subresourceRange.baseMipLevel = i - 1;
-        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-                             0, nullptr, 0, nullptr, 1, &barrier);
-
-        VkImageBlit blit{};
-        blit.srcOffsets[0] = { 0, 0, 0 };
-        blit.srcOffsets[1] = { mip_width, mip_height, 1 };
-        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        blit.srcSubresource.mipLevel = i - 1;
-        blit.srcSubresource.baseArrayLayer = 0;
-        blit.srcSubresource.layerCount = 1;
-        blit.dstOffsets[0] = { 0, 0, 0 };
-        blit.dstOffsets[1] = { mip_width > 1 ? mip_width / 2 : 1, mip_height > 1 ? mip_height / 2 : 1, 1 };
-        blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        blit.dstSubresource.mipLevel = i;
-        blit.dstSubresource.baseArrayLayer = 0;
-        blit.dstSubresource.layerCount = 1;
-
-        vkCmdBlitImage(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                       1, &blit, VK_FILTER_LINEAR);
-
-        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-                             0, nullptr, 0, nullptr, 1, &barrier);
-
-        if (mip_width > 1) mip_width /= 2;
-        if (mip_height > 1) mip_height /= 2;
-    }
-
-    barrier.subresourceRange.baseMipLevel = mip_levels - 1;
-    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-                         0, nullptr, 0, nullptr, 1, &barrier);
-
-    end_single_time_commands(command_buffer);
-}
-
 void Renderer::draw_frame()
 {
-    vkWaitForFences(device, 1, &inflight_fences[current_frame], VK_TRUE, UINT64_MAX);
+    auto wait_start = std::chrono::steady_clock::now();
+    lvk::frame_slot & frame = frame_scheduler.begin_frame();
+    auto wait_end = std::chrono::steady_clock::now();
+    deferred_work.collect(graphics_timeline.completed());
 
     uint32_t image_index;
-    auto result = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, image_available_semaphores[current_frame], VK_NULL_HANDLE, &image_index);
+    VkResult result;
+    {
+        ScopedFrameTimer timer(frame_stats, FrameMetric::acquire);
+        result = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, frame.image_available, VK_NULL_HANDLE, &image_index);
+    }
     if (result == VK_ERROR_OUT_OF_DATE_KHR)
     {
         recreate_swapchain();
@@ -1116,32 +1539,68 @@ void Renderer::draw_frame()
     else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
         throw std::runtime_error("failed to acquire swap chain image");
 
-    if (inflight_images[image_index] != VK_NULL_HANDLE)
-        vkWaitForFences(device, 1, &inflight_images[image_index], VK_TRUE, UINT64_MAX);
+    {
+        // Both the frame slot wait and the swapchain image wait count as fence wait time
+        auto image_wait_start = std::chrono::steady_clock::now();
+        frame_scheduler.wait_for_image(image_index);
+        auto image_wait = std::chrono::steady_clock::now() - image_wait_start;
+        frame_stats.record(FrameMetric::fence_wait, std::chrono::duration<double, std::milli>(wait_end - wait_start + image_wait).count());
+    }
 
-    inflight_images[image_index] = inflight_fences[current_frame];
+    // The last submission of this image's command buffer has completed, so its timestamps are ready
+    lvk_gpu_profiler.collect(image_index);
 
-    update_uniform_buffer(image_index);
+    // Queues the next texture levels, then submits pending uploads and hands finished ones to the graphics queue ahead of this frame
+    texture_streamer.update();
+    upload_engine.update();
+    // The scene keeps rendering with the placeholder, so a failed decode is only reported
+    if (!texture_error_reported && !texture_streamer.error(texture).empty())
+    {
+        std::cerr << "Texture failed to load: " << texture_streamer.error(texture) << std::endl;
+        texture_error_reported = true;
+    }
 
-    VkSubmitInfo submit_info = {};
-    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    // Moves finished by the defragmenter swap handles the descriptor sets and recorded commands still point at
+    defragmenter.update();
+    refresh_image_bindings(image_index);
 
-    VkSemaphore wait_semaphores[] = { image_available_semaphores[current_frame] };
-    VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submit_info.waitSemaphoreCount = 1;
-    submit_info.pWaitSemaphores = wait_semaphores;
-    submit_info.pWaitDstStageMask = wait_stages;
-    submit_info.commandBufferCount = 1;
-    submit_info.pCommandBuffers = &command_buffers[image_index];
+    // Budgets move slowly, so querying them every few frames is enough to fire pressure callbacks in time
+    if (frame_scheduler.frame_number() % LAVA_MEMORY_BUDGET_INTERVAL == 0)
+        lvk_memory_budget.update();
 
-    VkSemaphore signal_semaphores[] = { render_finished_semaphores[current_frame] };
-    submit_info.signalSemaphoreCount = 1;
-    submit_info.pSignalSemaphores = signal_semaphores;
+    // The image's previous frame has completed, so its transient data can be overwritten. The transform
+    // update writes into it while the draws are being recorded.
+    uniform_ring.begin_region(image_index);
+    lvk::job_counter uniforms_updated;
+    UniformBufferObject ubo;
+    jobs.run([&]() { ubo = update_uniform_buffer(); }, &uniforms_updated);
 
-    vkResetFences(device, 1, &inflight_fences[current_frame]);
+    VkCommandBuffer frame_command_buffer = command_buffers[image_index];
+    if (command_recording_mode == RecordingMode::per_frame)
+        frame_command_buffer = record_frame(frame.index, image_index);
+    jobs.wait(uniforms_updated);
 
-    if (vkQueueSubmit(graphics_queue, 1, &submit_info, inflight_fences[current_frame]) != VK_SUCCESS)
+    VkResult submit_result;
+    {
+        ScopedFrameTimer timer(frame_stats, FrameMetric::submit);
+        lvk::timeline_submit submit;
+        submit.wait(frame.image_available, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+
+        // Culling runs on the compute queue, overlapping whatever the graphics queue is still rendering
+        if (gpu_culling_enabled && !draw_commands.empty())
+            submit.wait(compute_timeline, dispatch_culling(image_index, ubo), VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT);
+
+        submit_result = submit
+            .command_buffer(frame_command_buffer)
+            .signal(frame.render_finished)
+            .signal(graphics_timeline, frame_scheduler.signal_value(image_index))
+            .submit(graphics_queue);
+    }
+    if (submit_result != VK_SUCCESS)
         throw std::runtime_error("Failed to submit draw command buffer");
+    lvk_gpu_profiler.mark_submitted(image_index);
+
+    VkSemaphore signal_semaphores[] = { frame.render_finished };
 
     VkPresentInfoKHR present_info = {};
     present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -1154,7 +1613,10 @@ void Renderer::draw_frame()
     present_info.pImageIndices = &image_index;
     present_info.pResults = nullptr;
 
-    result = vkQueuePresentKHR(present_queue, &present_info);
+    {
+        ScopedFrameTimer timer(frame_stats, FrameMetric::present);
+        result = vkQueuePresentKHR(present_queue, &present_info);
+    }
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || window_resized)
     {
         window_resized = false;
@@ -1164,12 +1626,11 @@ void Renderer::draw_frame()
     else if (result != VK_SUCCESS)
         throw std::runtime_error("failed to present swap chain image");
 
-    vkQueueWaitIdle(present_queue);
-
-    current_frame = (current_frame + 1) % LAVA_MAX_FRAMES_IN_FLIGHT;
+    // No queue idle here; the next use of this frame slot waits on its own fence instead
+    frame_scheduler.end_frame();
 }
 
-void Renderer::update_uniform_buffer(uint32_t current_image)
+UniformBufferObject Renderer::update_uniform_buffer()
 {
     static auto start = std::chrono::high_resolution_clock::now();
     auto current_time = std::chrono::high_resolution_clock::now();
@@ -1182,42 +1643,55 @@ void Renderer::update_uniform_buffer(uint32_t current_image)
     ubo.proj[1][1] *= -1.0f;
     ubo.hue_shift = time * glm::radians(10.0f);
 
-    void * data;
-    vkMapMemory(device, uniform_buffers_memory[current_image], 0, sizeof(ubo), 0, &data);
-    memcpy_s(data, sizeof(ubo), &ubo, sizeof(ubo));
-    vkUnmapMemory(device, uniform_buffers_memory[current_image]);
+    uniform_ring.push(ubo);
+    return ubo;
 }
 
 Renderer::~Renderer()
 {
+    vkDeviceWaitIdle(device);
     destroy_swapchain();
+    render_graph.destroy();
+    lvk_swapchain.destroy();
 
-    vkDestroySampler(device, texture_sampler, nullptr);
-    vkDestroyImageView(device, texture_image_view, nullptr);
-    vkDestroyImage(device, texture_image, nullptr);
-    vkFreeMemory(device, texture_image_memory, nullptr);
-
-    vkDestroyDescriptorSetLayout(device, descriptor_set_layout, nullptr);
-
-    vkDestroyBuffer(device, index_buffer, nullptr);
-    vkFreeMemory(device, index_buffer_memory, nullptr);
-
-    vkDestroyBuffer(device, vertex_buffer, nullptr);
-    vkFreeMemory(device, vertex_buffer_memory, nullptr);
-
-    for (int i = 0; i < LAVA_MAX_FRAMES_IN_FLIGHT; i++)
-    {
-        vkDestroySemaphore(device, image_available_semaphores[i], nullptr);
-        vkDestroySemaphore(device, render_finished_semaphores[i], nullptr);
-        vkDestroyFence(device, inflight_fences[i], nullptr);
-    }
-    vkDestroyCommandPool(device, command_pool, nullptr);
+    vkDestroySampler(device, texture_sampler, lvk::host_callbacks());
+    texture_streamer.destroy();
+
+    vkDestroyDescriptorSetLayout(device, descriptor_set_layout, lvk::host_callbacks());
+
+    vkDestroyBuffer(device, index_buffer, lvk::host_callbacks());
+    memory_allocator.free(index_buffer_allocation);
+
+    vkDestroyBuffer(device, vertex_buffer, lvk::host_callbacks());
+    memory_allocator.free(vertex_buffer_allocation);
+
+    vkDestroyBuffer(device, draw_bounds_buffer, lvk::host_callbacks());
+    memory_allocator.free(draw_bounds_allocation);
+    vkDestroyPipeline(device, cull_pipeline, lvk::host_callbacks());
+    vkDestroyPipelineLayout(device, cull_pipeline_layout, lvk::host_callbacks());
+    vkDestroyDescriptorSetLayout(device, cull_descriptor_set_layout.vk(), lvk::host_callbacks());
+    vkDestroyCommandPool(device, compute_command_pool, lvk::host_callbacks());
+
+    frame_scheduler.destroy();
+    upload_engine.destroy();
+    mip_generator.destroy();
+    defragmenter.destroy();
+    lvk_gpu_profiler.destroy();
+    deferred_work.flush();
+    command_recorder.destroy();
+    frame_recorder.destroy();
+    static_draw_cache.destroy();
+    graphics_timeline.destroy();
+    compute_timeline.destroy();
+    vkDestroyCommandPool(device, command_pool, lvk::host_callbacks());
+    memory_allocator.destroy();
     
     lvk_device.destroy();
 
 #if USE_VALIDATION
     //lvk::destroy_debug_messenger(vulkan_instance, debug_messenger);
 #endif
+    // SDL creates the surface without allocation callbacks
     vkDestroySurfaceKHR(vulkan_instance, window_surface, nullptr);
     //vkDestroyInstance(vulkan_instance, nullptr);
     lvk_instance.destroy();
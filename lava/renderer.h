@@ -12,6 +12,22 @@
 #include "lvk/physical_device.h"
 #include "lvk/swapchain.h"
 #include "lvk/descriptor_set_layout.h"
+#include "lvk/frame_scheduler.h"
+#include "lvk/timeline.h"
+#include "lvk/gpu_profiler.h"
+#include "lvk/command_recorder.h"
+#include "lvk/command_cache.h"
+#include "lvk/upload_engine.h"
+#include "lvk/job_system.h"
+#include "lvk/render_graph.h"
+#include "lvk/memory_allocator.h"
+#include "lvk/ring_buffer.h"
+#include "lvk/memory_budget.h"
+#include "lvk/defragmenter.h"
+#include "lvk/host_allocator.h"
+#include "lvk/texture_streamer.h"
+#include "lvk/task_graph.h"
+#include "frame_stats.h"
 
 struct SDL_Window;
 
@@ -36,6 +52,59 @@ namespace lava
         bool operator==(const Vertex & other) const { return position == other.position && color == other.color && texcoord == other.texcoord; }
     };
 
+    // A contiguous range of the model's index buffer, recorded as one indexed draw
+    struct DrawCommand
+    {
+        uint32_t first_index;
+        uint32_t index_count;
+    };
+
+    enum class RecordingMode
+    {
+        prerecorded,    // One command buffer per swapchain image, re-recorded only with the swapchain
+        per_frame       // Re-recorded every frame from the draw list into transient pools
+    };
+
+    struct RecordingBenchmarkResult
+    {
+        uint32_t workers;
+        uint32_t draws;
+        double ms_per_frame;
+        double ns_per_draw;
+    };
+
+    struct JobBenchmarkResult
+    {
+        uint32_t workers;
+        uint32_t draws;
+        double ms_per_iteration;
+        double speedup;
+    };
+
+    struct MipmapBenchmarkResult
+    {
+        lvk::mip_generation_path path;
+        uint32_t size;
+        uint32_t mip_levels;
+        double gpu_ms;          // Per chain, 0 when the queue has no timestamps
+        double record_ms;
+    };
+
+    // Model space bounding sphere of a static draw, read by the culling compute shader
+    struct DrawBounds
+    {
+        glm::vec4 sphere;
+        uint32_t first_index;
+        uint32_t index_count;
+        uint32_t pad[2];
+    };
+
+    struct CullParameters
+    {
+        glm::vec4 planes[6];
+        uint32_t draw_count;
+    };
+
     struct UniformBufferObject
     {
         glm::mat4 transform;
@@ -55,7 +124,37 @@ namespace lava
 
         void handle_window_resize();
 
+        void set_frames_in_flight(uint32_t count);
+        uint32_t frames_in_flight() const { return frame_scheduler.frames_in_flight(); }
+
+        void set_present_policy(lvk::present_policy policy);
+        lvk::present_policy get_present_policy() const { return present_policy; }
+
+        void set_recording_mode(RecordingMode mode);
+        RecordingMode recording_mode() const { return command_recording_mode; }
+        void set_static_draws(const std::vector<DrawCommand> & draws);
+        void set_gpu_culling(bool enabled);
+        bool gpu_culling() const { return gpu_culling_enabled; }
+        const std::vector<DrawCommand> & static_draws() const { return draw_commands; }
+        std::vector<DrawCommand> & dynamic_draws() { return dynamic_draw_commands; }
+        std::vector<RecordingBenchmarkResult> benchmark_recording(uint32_t draw_count, uint32_t iterations);
+        std::vector<JobBenchmarkResult> benchmark_jobs(uint32_t draw_count, uint32_t iterations);
+        // Generates the mip chain of a size x size RGBA8 sRGB texture with every path the device supports
+        std::vector<MipmapBenchmarkResult> benchmark_mipmaps(uint32_t size, uint32_t iterations);
+
+        FrameStats & stats() { return frame_stats; }
+        lvk::gpu_profiler & gpu_profiler() { return lvk_gpu_profiler; }
+        lvk::memory_allocator_stats memory_stats() const { return memory_allocator.stats(); }
+        lvk::memory_budget & memory_budget() { return lvk_memory_budget; }
+        lvk::render_graph_memory_stats render_target_memory_stats() const { return render_graph.memory_stats(); }
+        const lvk::defragmenter_stats & defragmentation_stats() const { return defragmenter.stats(); }
+        lvk::staging_pool_stats staging_stats() const { return upload_engine.staging_stats(); }
+        // How long each startup task took and when it started, and the wall time of the whole graph
+        const std::vector<lvk::task_timing> & startup_timings() const { return startup_tasks; }
+        double startup_time() const { return startup_time_ms; }
+
     private:
+        lvk::job_system jobs;
         lvk::instance lvk_instance;
         VkInstance vulkan_instance;
         VkDebugUtilsMessengerEXT debug_messenger;
@@ -64,12 +163,18 @@ namespace lava
         VkDevice device;
         uint32_t graphics_queue_family_index;
         uint32_t present_queue_family_index;
+        uint32_t transfer_queue_family_index;
         VkQueue graphics_queue;
         VkQueue present_queue;
+        VkQueue transfer_queue;
+        lvk::queue compute_queue;
         VkSurfaceKHR window_surface;
         lvk::swapchain lvk_swapchain;
+        lvk::present_policy present_policy;
         VkSwapchainKHR swapchain;
-        std::vector<VkFramebuffer> swapchain_framebuffers;
+        lvk::render_graph render_graph;
+        lvk::render_graph::resource backbuffer;
+        uint32_t forward_pass;
         VkRenderPass render_pass;
         lvk::descriptor_set_layout lvk_descriptor_set_layout;
         VkDescriptorSetLayout descriptor_set_layout;
@@ -77,53 +182,76 @@ namespace lava
         VkPipeline graphics_pipeline;
         VkCommandPool command_pool;
         std::vector<VkCommandBuffer> command_buffers;
+        lvk::command_recorder command_recorder;
+        lvk::command_recorder frame_recorder;
+        lvk::command_cache static_draw_cache;
+        RecordingMode command_recording_mode;
         VkBuffer vertex_buffer;
-        VkDeviceMemory vertex_buffer_memory;
+        lvk::allocation vertex_buffer_allocation;
         VkBuffer index_buffer;
-        VkDeviceMemory index_buffer_memory;
+        lvk::allocation index_buffer_allocation;
         VkDescriptorPool descriptor_pool;
         std::vector<VkDescriptorSet> descriptor_sets;
-        uint32_t mip_levels;
-        VkImage texture_image;
-        VkDeviceMemory texture_image_memory;
-        VkImageView texture_image_view;
+        lvk::texture_streamer texture_streamer;
+        uint32_t texture;
+        bool texture_error_reported;
+        std::vector<uint64_t> texture_descriptor_versions;
         VkSampler texture_sampler;
 
-        VkImage depth_image;
-        VkDeviceMemory depth_image_memory;
-        VkImageView depth_image_view;
-
         VkSampleCountFlagBits msaa_samples;
 
-        std::vector<VkBuffer> uniform_buffers;
-        std::vector<VkDeviceMemory> uniform_buffers_memory;
+        lvk::ring_buffer uniform_ring;
 
-        std::vector<VkSemaphore> image_available_semaphores;
-        std::vector<VkSemaphore> render_finished_semaphores;
-        std::vector<VkFence> inflight_fences;
-        std::vector<VkFence> inflight_images;
+        lvk::timeline graphics_timeline;
+        lvk::frame_scheduler frame_scheduler;
+        lvk::deferred_queue deferred_work;
+        lvk::memory_allocator memory_allocator;
+        lvk::memory_budget lvk_memory_budget;
+        lvk::mip_generator mip_generator;
+        lvk::upload_engine upload_engine;
+        lvk::defragmenter defragmenter;
+        // Bumped by geometry moves; each image's recordings catch up before its next frame
+        uint64_t geometry_version;
+        std::vector<uint64_t> geometry_versions;
+        bool geometry_release_pending;
+        lvk::upload_ticket scene_upload;
+
+        bool gpu_culling_enabled;
+        bool multi_draw_indirect;
+        lvk::timeline compute_timeline;
+        lvk::descriptor_set_layout cull_descriptor_set_layout;
+        VkPipelineLayout cull_pipeline_layout;
+        VkPipeline cull_pipeline;
+        VkCommandPool compute_command_pool;
+        std::vector<VkCommandBuffer> compute_command_buffers;
+        VkDescriptorPool cull_descriptor_pool;
+        std::vector<VkDescriptorSet> cull_descriptor_sets;
+        std::vector<VkBuffer> indirect_buffers;
+        std::vector<lvk::allocation> indirect_buffers_allocations;
+        VkBuffer draw_bounds_buffer;
+        lvk::allocation draw_bounds_allocation;
+        FrameStats frame_stats;
+        lvk::gpu_profiler lvk_gpu_profiler;
 
         std::vector<Vertex> vertices;
         std::vector<uint32_t> indices;
-
-        VkImage color_image;
-        VkDeviceMemory color_image_memory;
-        VkImageView color_image_view;
-
-        int current_frame;
+        std::vector<DrawCommand> draw_commands;
+        std::vector<DrawCommand> dynamic_draw_commands;
+        uint64_t static_draws_version;
+        std::vector<lvk::task_timing> startup_tasks;
+        double startup_time_ms;
 
         VkPhysicalDevice select_optimal_physical_device(const std::vector<VkPhysicalDevice> & physical_devices);
 
+        void create_instance();
+        void create_device();
         void create_image_views();
-        void create_render_pass();
+        void create_render_graph();
+        void create_render_graph_resources();
         void create_descriptor_set_layout();
         void create_graphics_pipeline();
-        void create_framebuffers();
         void create_command_pool();
-        void create_color_resources();
-        void create_depth_resources();
-        void create_texture_image();
-        void create_texture_image_view();
+        void stream_texture();
         void create_texture_sampler();
         void load_model();
         void create_vertex_buffer();
@@ -132,23 +260,38 @@ namespace lava
         void create_descriptor_pool();
         void create_descriptor_sets();
         void create_command_buffers();
+        void record_frame_commands(VkCommandBuffer command_buffer, uint32_t image_index, lvk::command_recorder & recorder, uint32_t recorder_frame,
+                                   const std::vector<DrawCommand> & draws, uint32_t indirect_count, VkCommandBufferUsageFlags usage, bool profile,
+                                   const std::vector<VkCommandBuffer> & cached_secondaries = {});
+        void record_draws(VkCommandBuffer command_buffer, uint32_t image_index, const std::vector<DrawCommand> & draws, uint32_t indirect_count,
+                          uint32_t first, uint32_t last, bool profile);
+        VkCommandBuffer record_frame(uint32_t slot_index, uint32_t image_index);
         void create_sync_objects();
+        void create_cull_pipeline();
+        void create_draw_bounds_buffer();
+        std::vector<DrawBounds> compute_draw_bounds(lvk::job_system & system, const std::vector<DrawCommand> & draws) const;
+        void create_cull_resources();
+        void destroy_cull_resources();
+        uint64_t dispatch_culling(uint32_t image_index, const UniformBufferObject & ubo);
+        void rerecord_command_buffers();
+        void rerecord_command_buffer(uint32_t image_index);
+        void update_texture_descriptors();
+        void write_texture_descriptor(uint32_t image_index);
+        void refresh_image_bindings(uint32_t image_index);
+        void create_gpu_profiler();
+        void name_gpu_profiler_frames();
+        void create_swapchain();
+        void create_swapchain_image_resources();
+        void destroy_swapchain_image_resources();
         void destroy_swapchain();
         void recreate_swapchain();
 
-        void create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer * buffer, VkDeviceMemory * memory);
-        void copy_buffer(VkBuffer src, VkBuffer dst, VkDeviceSize size);
-        void create_image(uint32_t width, uint32_t height, uint32_t mip_levels, VkSampleCountFlagBits sample_count, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage * image, VkDeviceMemory * memory);
-        VkCommandBuffer begin_single_time_commands();
-        void end_single_time_commands(VkCommandBuffer command_buffer);
-        void transition_image_layout(VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, uint32_t mip_levels);
-        void copy_buffer_to_image(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
-        VkImageView create_image_view(VkImage image, VkFormat format, VkImageAspectFlags aspect_flags, uint32_t mip_levels);
+        void create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer * buffer, lvk::allocation * allocation,
+                           const std::vector<uint32_t> & queue_families = {}, VkBufferCreateInfo * created_info = nullptr);
         VkFormat find_supported_format(const std::vector<VkFormat> & candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
         VkFormat find_depth_format();
-        void generate_mipmaps(VkImage image, VkFormat format, int32_t width, int32_t height, uint32_t mip_levels);
 
-        void update_uniform_buffer(uint32_t current_image);
+        UniformBufferObject update_uniform_buffer();
 
         SDL_Window * sdl_window;
         bool window_resized;
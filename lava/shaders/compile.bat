@@ -1,2 +1,4 @@
 glslc shader.vert -o vert.spv
-glslc shader.frag -o frag.spv
\ No newline at end of file
+glslc shader.frag -o frag.spv
+glslc cull.comp -o cull.spv
+glslc mipgen.comp -o mipgen.spv
\ No newline at end of file
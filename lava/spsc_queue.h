@@ -0,0 +1,71 @@
+#ifndef LAVA_SPSC_QUEUE_H
+#define LAVA_SPSC_QUEUE_H
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+namespace lava
+{
+    // Bounded lock-free queue for exactly one producer thread and one consumer thread.
+    // Each side only writes its own index, and the acquire/release pair on the indices
+    // publishes the slot contents. Capacity is rounded up to a power of two.
+    template <typename T>
+    class SpscQueue
+    {
+    public:
+        SpscQueue(size_t capacity = 256)
+        {
+            size_t size = 2;
+            while (size < capacity)
+                size *= 2;
+            slots.resize(size);
+            mask = size - 1;
+        }
+
+        // Producer side, returns false if the consumer has fallen a full queue behind
+        bool push(const T & value)
+        {
+            size_t tail = write_index.load(std::memory_order_relaxed);
+            if (tail - cached_read_index > mask)
+            {
+                cached_read_index = read_index.load(std::memory_order_acquire);
+                if (tail - cached_read_index > mask)
+                    return false;
+            }
+            slots[tail & mask] = value;
+            write_index.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side
+        bool pop(T & value)
+        {
+            size_t head = read_index.load(std::memory_order_relaxed);
+            if (head == cached_write_index)
+            {
+                cached_write_index = write_index.load(std::memory_order_acquire);
+                if (head == cached_write_index)
+                    return false;
+            }
+            value = slots[head & mask];
+            read_index.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        size_t capacity() const { return slots.size(); }
+    private:
+        std::vector<T> slots;
+        size_t mask;
+
+        // Padding keeps the producer's and the consumer's indices off each other's cache line
+        char producer_padding[64];
+        std::atomic<size_t> write_index{ 0 };
+        size_t cached_read_index = 0;
+        char consumer_padding[64];
+        std::atomic<size_t> read_index{ 0 };
+        size_t cached_write_index = 0;
+    };
+}
+
+#endif